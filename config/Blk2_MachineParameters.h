@@ -0,0 +1,212 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Snapshot, confronto e ripristino dei parametri macchina (Block 2)
+// ============================================================================
+//
+// Formato dello snapshot (110 byte, esportato come stringa esadecimale):
+//   [0-1]   magic 'B' '2'
+//   [2]     versione del formato (BLK2_SNAPSHOT_VERSION)
+//   [3]     numero di registri (51)
+//   [4-5]   codice modello del Block 0 (0 = non verificato in ripristino)
+//   [6-107] immagine raw di 0x0200-0x0232, big-endian come sul bus
+//   [108-109] CRC16 Modbus dei byte precedenti, byte basso per primo
+//
+// Il ripristino scrive solo i registri diversi dall'immagine letta e presenti
+// nella whitelist, uniti in scritture FC16 su intervalli contigui (WriteRange).
+//
+// Richiede modbus_helpers.h (WriteRange)
+
+static const uint16_t BLK2_ADDRESS = 0x0200;
+static const uint16_t BLK2_REGISTER_COUNT = 51;
+static const size_t BLK2_IMAGE_SIZE = BLK2_REGISTER_COUNT * 2;
+static const uint8_t BLK2_SNAPSHOT_VERSION = 1;
+static const size_t BLK2_SNAPSHOT_HEADER_SIZE = 6;
+static const size_t BLK2_SNAPSHOT_SIZE = BLK2_SNAPSHOT_HEADER_SIZE + BLK2_IMAGE_SIZE + 2;
+
+// Registri esclusi dal ripristino: 0x0200 contiene stop/flush mode e la
+// velocità del bus (modbus_baud.h), 0x0212 la velocità manuale corrente
+static const uint64_t BLK2_RESTORE_WHITELIST =
+    ((1ULL << BLK2_REGISTER_COUNT) - 1) & ~(1ULL << (0x0200 - BLK2_ADDRESS)) & ~(1ULL << (0x0212 - BLK2_ADDRESS));
+
+// Registri invariati (ma in whitelist) che possono essere riscritti pur di
+// unire due intervalli in un solo frame: ogni frame in meno vale ~300 ms a 9600
+static const uint16_t BLK2_MAX_WRITE_GAP = 2;
+
+enum class Blk2SnapshotResult : uint8_t
+{
+  OK,
+  BAD_SIZE,
+  BAD_MAGIC,
+  BAD_VERSION,
+  BAD_CRC,
+  MODEL_MISMATCH
+};
+
+inline uint16_t blk2_register(const std::vector<uint8_t> &image, uint16_t index)
+{
+  return (image[index * 2] << 8) | image[index * 2 + 1];
+}
+
+// Crea lo snapshot da un'immagine di 102 byte; vuoto se l'immagine non è valida
+inline std::vector<uint8_t> blk2_make_snapshot(const std::vector<uint8_t> &image, uint16_t model_code)
+{
+  std::vector<uint8_t> blob;
+  if (image.size() != BLK2_IMAGE_SIZE)
+    return blob;
+
+  blob.reserve(BLK2_SNAPSHOT_SIZE);
+  blob.push_back('B');
+  blob.push_back('2');
+  blob.push_back(BLK2_SNAPSHOT_VERSION);
+  blob.push_back(BLK2_REGISTER_COUNT);
+  blob.push_back(model_code >> 8);
+  blob.push_back(model_code & 0xFF);
+  blob.insert(blob.end(), image.begin(), image.end());
+
+  uint16_t crc = modbusCrc16(blob, 0, blob.size());
+  blob.push_back(crc & 0xFF);
+  blob.push_back(crc >> 8);
+  return blob;
+}
+
+// Verifica uno snapshot ed estrae l'immagine. expected_model = 0 non controlla il modello
+inline Blk2SnapshotResult blk2_parse_snapshot(const std::vector<uint8_t> &blob, uint16_t expected_model,
+                                              std::vector<uint8_t> &image)
+{
+  if (blob.size() != BLK2_SNAPSHOT_SIZE)
+    return Blk2SnapshotResult::BAD_SIZE;
+  if (blob[0] != 'B' || blob[1] != '2')
+    return Blk2SnapshotResult::BAD_MAGIC;
+  if (blob[2] != BLK2_SNAPSHOT_VERSION || blob[3] != BLK2_REGISTER_COUNT)
+    return Blk2SnapshotResult::BAD_VERSION;
+
+  uint16_t crc = blob[BLK2_SNAPSHOT_SIZE - 2] | (blob[BLK2_SNAPSHOT_SIZE - 1] << 8);
+  if (modbusCrc16(blob, 0, BLK2_SNAPSHOT_SIZE - 2) != crc)
+    return Blk2SnapshotResult::BAD_CRC;
+
+  uint16_t model = (blob[4] << 8) | blob[5];
+  if (expected_model != 0 && model != 0 && model != expected_model)
+    return Blk2SnapshotResult::MODEL_MISMATCH;
+
+  image.assign(blob.begin() + BLK2_SNAPSHOT_HEADER_SIZE, blob.begin() + BLK2_SNAPSHOT_HEADER_SIZE + BLK2_IMAGE_SIZE);
+  return Blk2SnapshotResult::OK;
+}
+
+inline std::string blk2_to_hex(const std::vector<uint8_t> &blob)
+{
+  static const char digits[] = "0123456789ABCDEF";
+  std::string hex;
+  hex.reserve(blob.size() * 2);
+  for (size_t i = 0; i < blob.size(); i++)
+  {
+    hex += digits[blob[i] >> 4];
+    hex += digits[blob[i] & 0x0F];
+  }
+  return hex;
+}
+
+inline bool blk2_from_hex(const std::string &hex, std::vector<uint8_t> &blob)
+{
+  if (hex.size() % 2 != 0)
+    return false;
+
+  blob.clear();
+  blob.reserve(hex.size() / 2);
+  for (size_t i = 0; i < hex.size(); i += 2)
+  {
+    int value = 0;
+    for (size_t j = i; j < i + 2; j++)
+    {
+      char c = hex[j];
+      int nibble;
+      if (c >= '0' && c <= '9')
+        nibble = c - '0';
+      else if (c >= 'A' && c <= 'F')
+        nibble = c - 'A' + 10;
+      else if (c >= 'a' && c <= 'f')
+        nibble = c - 'a' + 10;
+      else
+        return false;
+      value = (value << 4) | nibble;
+    }
+    blob.push_back(value);
+  }
+  return true;
+}
+
+// Indici (0-50) dei registri diversi tra immagine letta e immagine da ripristinare
+inline std::vector<uint16_t> blk2_diff(const std::vector<uint8_t> &live, const std::vector<uint8_t> &target)
+{
+  std::vector<uint16_t> changed;
+  if (live.size() != BLK2_IMAGE_SIZE || target.size() != BLK2_IMAGE_SIZE)
+    return changed;
+  for (uint16_t i = 0; i < BLK2_REGISTER_COUNT; i++)
+    if (blk2_register(live, i) != blk2_register(target, i))
+      changed.push_back(i);
+  return changed;
+}
+
+// Piano di ripristino: registri cambiati e in whitelist, uniti in intervalli
+// contigui; un buco di al massimo max_gap registri in whitelist viene colmato
+// riscrivendo il valore attuale
+inline std::vector<WriteRange> blk2_restore_plan(const std::vector<uint8_t> &live, const std::vector<uint8_t> &target,
+                                                uint64_t whitelist = BLK2_RESTORE_WHITELIST,
+                                                uint16_t max_gap = BLK2_MAX_WRITE_GAP)
+{
+  std::vector<WriteRange> plan;
+  std::vector<uint16_t> changed = blk2_diff(live, target);
+
+  int first = -1, last = -1;
+  for (size_t k = 0; k <= changed.size(); k++)
+  {
+    int index = -1;
+    if (k < changed.size())
+    {
+      index = changed[k];
+      if (!(whitelist & (1ULL << index)))
+      {
+        ESP_LOGW("blk2", "Register 0x%04X differs but is not restorable, skipped", BLK2_ADDRESS + index);
+        continue;
+      }
+    }
+
+    // Prova ad estendere l'intervallo corrente fino a index
+    bool extend = first >= 0 && index >= 0 && index - last - 1 <= max_gap;
+    for (int g = last + 1; extend && g < index; g++)
+      if (!(whitelist & (1ULL << g)))
+        extend = false;
+
+    if (extend)
+    {
+      last = index;
+      continue;
+    }
+
+    if (first >= 0)
+    {
+      WriteRange write;
+      write.address = BLK2_ADDRESS + first;
+      for (int r = first; r <= last; r++)
+        write.values.push_back(blk2_register(target, r));
+      plan.push_back(write);
+    }
+    first = last = index;
+  }
+  return plan;
+}
+
+// Accoda il piano di ripristino come scritture FC16
+inline void blk2_queue_restore(modbus_controller::ModbusController *controller, const std::vector<WriteRange> &plan)
+{
+  for (size_t i = 0; i < plan.size(); i++)
+  {
+    auto cmd = modbus_controller::ModbusCommandItem::create_write_multiple_command(
+        controller, plan[i].address, plan[i].values.size(), plan[i].values);
+    controller->queue_command(cmd);
+    ESP_LOGD("blk2", "Restoring %d registers from 0x%04X", plan[i].values.size(), plan[i].address);
+  }
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -166,11 +167,404 @@ inline bool json_to_schedule_registers(const std::string &json_str,
   return true;
 }
 
-// Scrive un intero programma (tutti i 7 giorni) sui registri Modbus
-// json_data contiene un array di 7 JSON (uno per giorno)
-inline bool write_complete_schedule(modbus_controller::ModbusController *controller,
-                                    uint16_t base_address,
-                                    const std::vector<std::string> &days_json)
+// ============================================================================
+// Compilatore dei programmi giornalieri
+// ============================================================================
+//
+// La VMC usa per ogni giorno 8 intervalli fissi (orario, velocità) più la
+// velocità "sb" attiva da mezzanotte al primo intervallo. Gli slot inutilizzati
+// vengono riempiti con 23:59. Il compilatore accetta un numero qualsiasi di
+// transizioni (anche non ordinate), le ordina, elimina quelle che non cambiano
+// velocità e produce il layout canonico 8+9 registri: due programmi equivalenti
+// producono sempre gli stessi registri.
+
+static const int SCHEDULE_INTERVALS_PER_DAY = 8;
+static const uint16_t SCHEDULE_LAST_MINUTE = 23 * 60 + 59;
+
+struct ScheduleTransition
+{
+  uint16_t minute; // Minuti dalla mezzanotte (0-1439)
+  uint16_t speed;  // 0-4 o 255
+};
+
+enum class ScheduleCompileResult
+{
+  OK,
+  INVALID_TIME,            // Orario oltre le 23:59
+  INVALID_SPEED,           // Velocità diversa da 0-4 / 255
+  CONFLICTING_TRANSITIONS, // Due transizioni allo stesso orario con velocità diverse
+  TOO_MANY_INTERVALS,      // Servono più di 8 intervalli
+  INVALID_LAYOUT           // Registri diversi da 8 orari + 9 velocità
+};
+
+inline uint16_t schedule_time_to_minutes(uint16_t time_value)
+{
+  return ((time_value >> 8) & 0xFF) * 60 + (time_value & 0xFF);
+}
+
+inline uint16_t minutes_to_schedule_time(uint16_t minutes)
+{
+  return ((minutes / 60) << 8) | (minutes % 60);
+}
+
+// Compila una lista di transizioni nel layout canonico del giorno.
+// required_intervals (opzionale) riceve il numero di intervalli effettivamente
+// necessari, utile per segnalare i giorni che superano gli 8 slot.
+inline ScheduleCompileResult compile_day_schedule(uint16_t speed_before,
+                                                  std::vector<ScheduleTransition> transitions,
+                                                  std::vector<uint16_t> &time_registers,
+                                                  std::vector<uint16_t> &speed_registers,
+                                                  size_t *required_intervals = nullptr)
+{
+  time_registers.clear();
+  speed_registers.clear();
+
+  if (!is_valid_speed(speed_before))
+    return ScheduleCompileResult::INVALID_SPEED;
+
+  for (size_t i = 0; i < transitions.size(); i++)
+  {
+    if (transitions[i].minute > SCHEDULE_LAST_MINUTE)
+      return ScheduleCompileResult::INVALID_TIME;
+    if (!is_valid_speed(transitions[i].speed))
+      return ScheduleCompileResult::INVALID_SPEED;
+  }
+
+  std::stable_sort(transitions.begin(), transitions.end(),
+                   [](const ScheduleTransition &a, const ScheduleTransition &b)
+                   { return a.minute < b.minute; });
+
+  // Una transizione alle 00:00 sostituisce la velocità iniziale
+  uint16_t current = speed_before;
+  size_t first = 0;
+  while (first < transitions.size() && transitions[first].minute == 0)
+  {
+    if (first > 0 && transitions[first].speed != transitions[first - 1].speed)
+      return ScheduleCompileResult::CONFLICTING_TRANSITIONS;
+    current = transitions[first].speed;
+    first++;
+  }
+  speed_registers.push_back(current);
+
+  std::vector<ScheduleTransition> kept;
+  for (size_t i = first; i < transitions.size(); i++)
+  {
+    const ScheduleTransition &t = transitions[i];
+    if (i > first && t.minute == transitions[i - 1].minute)
+    {
+      if (t.speed != transitions[i - 1].speed)
+        return ScheduleCompileResult::CONFLICTING_TRANSITIONS;
+      continue;
+    }
+    if (t.speed == current)
+      continue; // Non cambia velocità: ridondante
+    kept.push_back(t);
+    current = t.speed;
+  }
+
+  if (required_intervals != nullptr)
+    *required_intervals = kept.size();
+
+  if (kept.size() > SCHEDULE_INTERVALS_PER_DAY)
+  {
+    speed_registers.clear();
+    return ScheduleCompileResult::TOO_MANY_INTERVALS;
+  }
+
+  for (size_t i = 0; i < kept.size(); i++)
+  {
+    time_registers.push_back(minutes_to_schedule_time(kept[i].minute));
+    speed_registers.push_back(kept[i].speed);
+  }
+
+  // Riempimento con 23:59 alla velocità già attiva: nessun effetto sulla ventilazione
+  while (time_registers.size() < SCHEDULE_INTERVALS_PER_DAY)
+  {
+    time_registers.push_back(minutes_to_schedule_time(SCHEDULE_LAST_MINUTE));
+    speed_registers.push_back(current);
+  }
+
+  return ScheduleCompileResult::OK;
+}
+
+// Riporta un giorno già in formato registri (8 orari + 9 velocità) alla forma canonica
+inline ScheduleCompileResult canonicalize_schedule_registers(std::vector<uint16_t> &time_registers,
+                                                             std::vector<uint16_t> &speed_registers)
+{
+  if (time_registers.size() != SCHEDULE_INTERVALS_PER_DAY ||
+      speed_registers.size() != SCHEDULE_INTERVALS_PER_DAY + 1)
+    return ScheduleCompileResult::INVALID_LAYOUT;
+
+  std::vector<ScheduleTransition> transitions;
+  for (int i = 0; i < SCHEDULE_INTERVALS_PER_DAY; i++)
+  {
+    if (!is_valid_time(time_registers[i]))
+      return ScheduleCompileResult::INVALID_TIME;
+    ScheduleTransition t = {schedule_time_to_minutes(time_registers[i]), speed_registers[i + 1]};
+    transitions.push_back(t);
+  }
+
+  uint16_t speed_before = speed_registers[0];
+  return compile_day_schedule(speed_before, transitions, time_registers, speed_registers);
+}
+
+// Estrae i registri di un giorno (1-7) dall'immagine raw di un programma (238 byte)
+inline bool extract_day_registers(const std::vector<uint8_t> &data, int day_number,
+                                  std::vector<uint16_t> &time_registers,
+                                  std::vector<uint16_t> &speed_registers)
+{
+  time_registers.clear();
+  speed_registers.clear();
+  if (data.size() != 238 || day_number < 1 || day_number > 7)
+    return false;
+
+  int day = day_number - 1;
+  for (int interval = 0; interval < SCHEDULE_INTERVALS_PER_DAY; interval++)
+    time_registers.push_back(readUnsigned16(data, (day * 8 + interval) * 2));
+  for (int n = 0; n < SCHEDULE_INTERVALS_PER_DAY + 1; n++)
+    speed_registers.push_back(readUnsigned16(data, (56 + day * 9 + n) * 2));
+  return true;
+}
+
+// Converte il JSON di un giorno con un numero qualsiasi di intervalli
+// (anche non ordinati) nel layout canonico dei registri
+inline ScheduleCompileResult json_to_compiled_schedule_registers(const std::string &json_str,
+                                                                 std::vector<uint16_t> &time_registers,
+                                                                 std::vector<uint16_t> &speed_registers,
+                                                                 size_t *required_intervals = nullptr)
+{
+  time_registers.clear();
+  speed_registers.clear();
+
+  size_t sb_pos = json_str.find("\"sb\":");
+  size_t intervals_start = json_str.find("\"i\":[");
+  if (sb_pos == std::string::npos || intervals_start == std::string::npos)
+  {
+    ESP_LOGE("json_parse", "Cannot find 'sb' or intervals array in JSON");
+    return ScheduleCompileResult::INVALID_SPEED;
+  }
+
+  uint16_t speed_before = std::stoi(json_str.substr(sb_pos + 5));
+  size_t intervals_end = json_str.find(']', intervals_start);
+
+  std::vector<ScheduleTransition> transitions;
+  size_t pos = intervals_start + 5;
+  while (true)
+  {
+    size_t t_pos = json_str.find("\"t\":\"", pos);
+    if (t_pos == std::string::npos || t_pos > intervals_end)
+      break;
+
+    std::string time_str = json_str.substr(t_pos + 5, 5); // "HH:MM"
+    int hour = std::stoi(time_str.substr(0, 2));
+    int minute = std::stoi(time_str.substr(3, 2));
+    if (hour > 23 || minute > 59)
+    {
+      ESP_LOGE("json_parse", "Invalid time %02d:%02d", hour, minute);
+      return ScheduleCompileResult::INVALID_TIME;
+    }
+
+    size_t s_pos = json_str.find("\"s\":", t_pos);
+    if (s_pos == std::string::npos || s_pos > intervals_end)
+    {
+      ESP_LOGE("json_parse", "Cannot find speed for interval %d", (int)transitions.size());
+      return ScheduleCompileResult::INVALID_SPEED;
+    }
+
+    ScheduleTransition t = {(uint16_t)(hour * 60 + minute), (uint16_t)std::stoi(json_str.substr(s_pos + 4))};
+    transitions.push_back(t);
+    pos = s_pos + 4;
+  }
+
+  ScheduleCompileResult result = compile_day_schedule(speed_before, transitions, time_registers,
+                                                      speed_registers, required_intervals);
+  if (result != ScheduleCompileResult::OK)
+    ESP_LOGE("json_parse", "Schedule compile failed (%d)", (int)result);
+  return result;
+}
+
+// ============================================================================
+// Timeline settimanale compressa (run-length) di un programma
+// ============================================================================
+//
+// I 7 giorni di un programma diventano una sequenza di run (minuto di inizio
+// nella settimana, velocità): al massimo 7 x (1 + 8) = 63 run per 10080 minuti,
+// con i run uguali consecutivi fusi anche a cavallo della mezzanotte. Il minuto
+// 0 è lunedì 00:00 (giorno 1 del programma). Le query usano la ricerca binaria
+// sui run e somme cumulative per velocità precalcolate in build().
+
+static const uint16_t WEEK_MINUTES = 7 * 1440;
+static const size_t SPEED_TIMELINE_MAX_RUNS = 7 * (SCHEDULE_INTERVALS_PER_DAY + 1);
+static const size_t SPEED_TIMELINE_SPEEDS = 6; // 0-4 e 255
+
+struct SpeedRun
+{
+  uint16_t start; // Minuto della settimana (0-10079); il run dura fino al successivo
+  uint8_t speed;
+};
+
+class SpeedTimeline
+{
+public:
+  // Costruisce la timeline dall'immagine raw (238 byte); false se non valida
+  bool build(const std::vector<uint8_t> &program_image)
+  {
+    runs_.clear();
+    valid_ = false;
+    for (int day = 1; day <= 7; day++)
+    {
+      std::vector<uint16_t> time_regs, speed_regs;
+      if (!extract_day_registers(program_image, day, time_regs, speed_regs) ||
+          canonicalize_schedule_registers(time_regs, speed_regs) != ScheduleCompileResult::OK)
+        return false;
+
+      uint16_t day_start = (day - 1) * 1440;
+      append(day_start, speed_regs[0]);
+      for (int i = 0; i < SCHEDULE_INTERVALS_PER_DAY; i++)
+      {
+        uint16_t minute = schedule_time_to_minutes(time_regs[i]);
+        if (minute == SCHEDULE_LAST_MINUTE && speed_regs[i + 1] == runs_.back().speed)
+          break; // Riempimento canonico
+        append(day_start + minute, speed_regs[i + 1]);
+      }
+    }
+
+    // Somme cumulative per velocità all'inizio di ogni run (+ fine settimana)
+    cumulative_.assign((runs_.size() + 1) * SPEED_TIMELINE_SPEEDS, 0);
+    for (size_t r = 0; r < runs_.size(); r++)
+    {
+      for (size_t k = 0; k < SPEED_TIMELINE_SPEEDS; k++)
+        cumulative_[(r + 1) * SPEED_TIMELINE_SPEEDS + k] = cumulative_[r * SPEED_TIMELINE_SPEEDS + k];
+      cumulative_[(r + 1) * SPEED_TIMELINE_SPEEDS + speed_index(runs_[r].speed)] += run_length(r);
+    }
+    valid_ = true;
+    return true;
+  }
+
+  bool valid() const { return valid_; }
+  const std::vector<SpeedRun> &runs() const { return runs_; }
+
+  // Velocità attiva al minuto indicato della settimana
+  uint8_t speed_at(uint16_t minute_of_week) const
+  {
+    if (!valid_)
+      return 0;
+    return runs_[run_at(minute_of_week % WEEK_MINUTES)].speed;
+  }
+
+  // Minuti alla velocità indicata nell'intera settimana
+  uint16_t minutes_at_speed(uint8_t speed) const
+  {
+    if (!valid_ || !is_valid_speed(speed))
+      return 0;
+    return cumulative_[runs_.size() * SPEED_TIMELINE_SPEEDS + speed_index(speed)];
+  }
+
+  // Minuti alla velocità indicata in [from, to) (minuti della settimana, from <= to)
+  uint16_t minutes_at_speed(uint8_t speed, uint16_t from, uint16_t to) const
+  {
+    if (!valid_ || !is_valid_speed(speed) || from >= to)
+      return 0;
+    if (to > WEEK_MINUTES)
+      to = WEEK_MINUTES;
+    return minutes_before(speed, to) - minutes_before(speed, from);
+  }
+
+  // Forma compatta: 3 byte per run (inizio big-endian, velocità)
+  std::vector<uint8_t> to_bytes() const
+  {
+    std::vector<uint8_t> out;
+    for (size_t r = 0; r < runs_.size(); r++)
+    {
+      out.push_back(runs_[r].start >> 8);
+      out.push_back(runs_[r].start & 0xFF);
+      out.push_back(runs_[r].speed);
+    }
+    return out;
+  }
+
+  // [[inizio,velocità],...] per servizi ed eventi
+  std::string to_json() const
+  {
+    std::string json = "[";
+    for (size_t r = 0; r < runs_.size(); r++)
+    {
+      if (r > 0)
+        json += ",";
+      json += "[" + std::to_string(runs_[r].start) + "," + std::to_string(runs_[r].speed) + "]";
+    }
+    return json + "]";
+  }
+
+private:
+  static size_t speed_index(uint8_t speed) { return speed == 255 ? 5 : speed; }
+
+  void append(uint16_t start, uint16_t speed)
+  {
+    if (!runs_.empty() && runs_.back().speed == speed)
+      return; // Stessa velocità del run precedente (anche dal giorno prima)
+    if (!runs_.empty() && runs_.back().start == start)
+    {
+      runs_.back().speed = speed; // Transizione a 00:00: sostituisce la velocità iniziale
+      if (runs_.size() > 1 && runs_[runs_.size() - 2].speed == speed)
+        runs_.pop_back();
+      return;
+    }
+    SpeedRun run = {start, (uint8_t)speed};
+    runs_.push_back(run);
+  }
+
+  uint16_t run_length(size_t r) const
+  {
+    uint16_t end = r + 1 < runs_.size() ? runs_[r + 1].start : WEEK_MINUTES;
+    return end - runs_[r].start;
+  }
+
+  // Indice del run che contiene il minuto (ricerca binaria)
+  size_t run_at(uint16_t minute) const
+  {
+    size_t low = 0, high = runs_.size();
+    while (high - low > 1)
+    {
+      size_t mid = (low + high) / 2;
+      if (runs_[mid].start <= minute)
+        low = mid;
+      else
+        high = mid;
+    }
+    return low;
+  }
+
+  // Minuti alla velocità indicata in [0, minute)
+  uint16_t minutes_before(uint8_t speed, uint16_t minute) const
+  {
+    if (minute >= WEEK_MINUTES)
+      return minutes_at_speed(speed);
+    size_t r = run_at(minute);
+    uint16_t total = cumulative_[r * SPEED_TIMELINE_SPEEDS + speed_index(speed)];
+    if (runs_[r].speed == speed)
+      total += minute - runs_[r].start;
+    return total;
+  }
+
+  std::vector<SpeedRun> runs_;
+  std::vector<uint16_t> cumulative_;
+  bool valid_ = false;
+};
+
+// Layout di un programma: 56 registri orari (giorno * 8 + intervallo) seguiti
+// da 63 registri di velocità (56 + giorno * 9 + n), tutti contigui
+static const uint16_t PROGRAM_TIME_REGISTERS = 7 * SCHEDULE_INTERVALS_PER_DAY;
+static const uint16_t PROGRAM_REGISTERS = PROGRAM_TIME_REGISTERS + 7 * (SCHEDULE_INTERVALS_PER_DAY + 1);
+
+// Compila i 7 giorni nei 119 registri del programma, sempre nel layout
+// canonico, tutto o niente: se un giorno non è valido ritorna false senza che
+// nulla sia stato scritto. Con current_program (immagine raw di 238 byte) i
+// giorni equivalenti in forma canonica mantengono i registri letti e
+// changed[giorno] resta false
+inline bool build_program_registers(const std::vector<std::string> &days_json,
+                                    const std::vector<uint8_t> *current_program,
+                                    std::vector<uint16_t> &registers, bool changed[7])
 {
   if (days_json.size() != 7)
   {
@@ -178,34 +572,157 @@ inline bool write_complete_schedule(modbus_controller::ModbusController *control
     return false;
   }
 
-  // Per ogni giorno
+  bool differential = current_program != nullptr && current_program->size() == 238;
+  registers.assign(PROGRAM_REGISTERS, 0);
+
   for (int day = 0; day < 7; day++)
   {
     std::vector<uint16_t> time_regs;
     std::vector<uint16_t> speed_regs;
+    changed[day] = true;
 
-    // Converti il JSON in registri
-    if (!json_to_schedule_registers(days_json[day], time_regs, speed_regs))
+    size_t required = 0;
+    ScheduleCompileResult result = json_to_compiled_schedule_registers(days_json[day], time_regs, speed_regs, &required);
+    if (result == ScheduleCompileResult::TOO_MANY_INTERVALS)
     {
-      ESP_LOGE("write_schedule", "Failed to parse day %d", day + 1);
+      ESP_LOGE("write_schedule", "Day %d needs %d intervals, max is %d", day + 1, (int)required, SCHEDULE_INTERVALS_PER_DAY);
       return false;
     }
-    else
+    if (result != ScheduleCompileResult::OK)
     {
-      ESP_LOGI("write_schedule", "Day %d parsed successfully: %s", day + 1, days_json[day].c_str());
+      ESP_LOGE("write_schedule", "Failed to compile day %d", day + 1);
+      return false;
     }
 
-    auto cmdTime = modbus_controller::ModbusCommandItem::create_write_multiple_command(
-        controller, base_address + (day * 8), time_regs.size(), time_regs);
-    controller->queue_command(cmdTime);
-    delay(50);
+    std::vector<uint16_t> current_time_regs;
+    std::vector<uint16_t> current_speed_regs;
+    if (differential && extract_day_registers(*current_program, day + 1, current_time_regs, current_speed_regs))
+    {
+      std::vector<uint16_t> canonical_time_regs = current_time_regs;
+      std::vector<uint16_t> canonical_speed_regs = current_speed_regs;
+      if (canonicalize_schedule_registers(canonical_time_regs, canonical_speed_regs) == ScheduleCompileResult::OK &&
+          canonical_time_regs == time_regs && canonical_speed_regs == speed_regs)
+      {
+        ESP_LOGI("write_schedule", "Day %d unchanged, skipping", day + 1);
+        changed[day] = false;
+        time_regs = current_time_regs;
+        speed_regs = current_speed_regs;
+      }
+    }
+
+    for (int interval = 0; interval < SCHEDULE_INTERVALS_PER_DAY; interval++)
+      registers[day * SCHEDULE_INTERVALS_PER_DAY + interval] = time_regs[interval];
+    for (int n = 0; n < SCHEDULE_INTERVALS_PER_DAY + 1; n++)
+      registers[PROGRAM_TIME_REGISTERS + day * (SCHEDULE_INTERVALS_PER_DAY + 1) + n] = speed_regs[n];
+  }
+  return true;
+}
+
+// Accoda la scrittura dei giorni first_day-last_day (0-6) di registers (119 registri):
+// due frame FC16 contigui, orari e velocità, oppure un unico frame con single_frame
+// (i registri intermedi sono quelli di registers). written riceve gli intervalli scritti
+inline void queue_program_frames(modbus_controller::ModbusController *controller, uint16_t base_address,
+                                 const std::vector<uint16_t> &registers, int first_day, int last_day,
+                                 bool single_frame, std::vector<WriteRange> *written = nullptr)
+{
+  uint16_t time_start = first_day * SCHEDULE_INTERVALS_PER_DAY;
+  uint16_t time_end = (last_day + 1) * SCHEDULE_INTERVALS_PER_DAY;
+  uint16_t speed_start = PROGRAM_TIME_REGISTERS + first_day * (SCHEDULE_INTERVALS_PER_DAY + 1);
+  uint16_t speed_end = PROGRAM_TIME_REGISTERS + (last_day + 1) * (SCHEDULE_INTERVALS_PER_DAY + 1);
 
-    auto cmdSpeed = modbus_controller::ModbusCommandItem::create_write_multiple_command(
-        controller, base_address + 56 + (day * 9), speed_regs.size(), speed_regs);
-    controller->queue_command(cmdSpeed);
-    delay(50);
+  if (single_frame)
+  {
+    std::vector<uint16_t> values(registers.begin() + time_start, registers.begin() + speed_end);
+    auto cmd = modbus_controller::ModbusCommandItem::create_write_multiple_command(
+        controller, base_address + time_start, values.size(), values);
+    controller->queue_command(cmd);
+    if (written != nullptr)
+      written->push_back({(uint16_t)(base_address + time_start), values});
+    return;
   }
 
-  ESP_LOGI("write_schedule", "Successfully wrote complete schedule");
+  std::vector<uint16_t> time_values(registers.begin() + time_start, registers.begin() + time_end);
+  auto cmdTime = modbus_controller::ModbusCommandItem::create_write_multiple_command(
+      controller, base_address + time_start, time_values.size(), time_values);
+  controller->queue_command(cmdTime);
+  if (written != nullptr)
+    written->push_back({(uint16_t)(base_address + time_start), time_values});
+
+  std::vector<uint16_t> speed_values(registers.begin() + speed_start, registers.begin() + speed_end);
+  auto cmdSpeed = modbus_controller::ModbusCommandItem::create_write_multiple_command(
+      controller, base_address + speed_start, speed_values.size(), speed_values);
+  controller->queue_command(cmdSpeed);
+  if (written != nullptr)
+    written->push_back({(uint16_t)(base_address + speed_start), speed_values});
+}
+
+// Scrive un intero programma (tutti i 7 giorni) sui registri Modbus
+// json_data contiene un array di 7 JSON (uno per giorno)
+// current_program (opzionale) è l'ultima immagine raw letta del programma: in questo
+// caso ogni giorno viene compilato in forma canonica e scritto solo se diverso
+// Tutti i giorni sono validati prima di accodare qualsiasi scrittura. I giorni da
+// scrivere (dal primo all'ultimo modificato) partono in due frame FC16 contigui,
+// orari e velocità, oppure in un unico frame (fino a 119 registri) con single_frame;
+// written (opzionale) riceve gli intervalli accodati per la rilettura di verifica
+inline bool write_complete_schedule(modbus_controller::ModbusController *controller,
+                                    uint16_t base_address,
+                                    const std::vector<std::string> &days_json,
+                                    const std::vector<uint8_t> *current_program = nullptr,
+                                    bool single_frame = false,
+                                    std::vector<WriteRange> *written = nullptr)
+{
+  std::vector<uint16_t> registers;
+  bool changed[7];
+  if (!build_program_registers(days_json, current_program, registers, changed))
+    return false;
+
+  int first_day = 0;
+  while (first_day < 7 && !changed[first_day])
+    first_day++;
+  if (first_day == 7)
+  {
+    ESP_LOGI("write_schedule", "Program unchanged, nothing to write");
+    return true;
+  }
+  int last_day = 6;
+  while (!changed[last_day])
+    last_day--;
+
+  queue_program_frames(controller, base_address, registers, first_day, last_day, single_frame, written);
+
+  ESP_LOGI("write_schedule", "Successfully wrote days %d-%d (%s)", first_day + 1, last_day + 1,
+           single_frame ? "1 frame" : "2 frames");
   return true;
-}
\ No newline at end of file
+}
+
+// Copia l'immagine raw (238 byte) di un programma su un altro programma
+// (base 0x0400/0x0500/0x0600/0x0700) senza passare dal JSON: l'immagine viene
+// validata per intero e scritta come programma completo
+inline bool copy_program_image(modbus_controller::ModbusController *controller,
+                               const std::vector<uint8_t> &source_program,
+                               uint16_t destination_address,
+                               bool single_frame = false,
+                               std::vector<WriteRange> *written = nullptr)
+{
+  if (source_program.size() != 238)
+  {
+    ESP_LOGE("copy_schedule", "Source program not read (%d bytes)", (int)source_program.size());
+    return false;
+  }
+
+  std::vector<uint16_t> registers(PROGRAM_REGISTERS);
+  for (uint16_t i = 0; i < PROGRAM_REGISTERS; i++)
+  {
+    registers[i] = readUnsigned16(source_program, i * 2);
+    bool valid = i < PROGRAM_TIME_REGISTERS ? is_valid_time(registers[i]) : is_valid_speed(registers[i]);
+    if (!valid)
+    {
+      ESP_LOGE("copy_schedule", "Invalid register %d in source program: 0x%04X", i, registers[i]);
+      return false;
+    }
+  }
+
+  queue_program_frames(controller, destination_address, registers, 0, 6, single_frame, written);
+  ESP_LOGI("copy_schedule", "Program copied to 0x%04X", destination_address);
+  return true;
+}
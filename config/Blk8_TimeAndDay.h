@@ -0,0 +1,233 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// ============================================================================
+// Sincronizzazione dell'orologio della VMC (Block 8) con stima della deriva
+// ============================================================================
+//
+// L'orologio della VMC (0x0800 = ora << 8 | minuti, 0x0801 = giorno 1-7, lunedì
+// = 1) viene confrontato con l'ora locale come minuto della settimana, in
+// aritmetica modulare: 23:59 di domenica e 00:00 di lunedì distano 1 minuto.
+// Dai campioni (uno ogni sample_interval_ms) una regressione lineare stima la
+// deriva in minuti al giorno; la correzione viene scritta una sola volta, quando
+// la retta prevede che l'errore raggiunga la soglia, invece di riscrivere
+// l'orologio a ogni controllo: schedule() dice dopo ogni lettura se va
+// (ri)armato il timer della scrittura.
+
+static const int32_t CLOCK_WEEK_MINUTES = 7 * 1440;
+static const uint32_t CLOCK_MS_PER_DAY = 86400000UL;
+static const uint32_t CLOCK_WRITE_SETTLE_MS = 90000; // Campioni ignorati dopo una correzione
+
+// Minuto della settimana (0 = lunedì 00:00) dei registri 0x0800/0x0801; -1 se non validi
+inline int32_t vmc_clock_minute_of_week(uint16_t hour_minute, uint16_t weekday)
+{
+  uint8_t hour = (hour_minute >> 8) & 0xFF;
+  uint8_t minute = hour_minute & 0xFF;
+  if (hour > 23 || minute > 59 || weekday < 1 || weekday > 7)
+    return -1;
+  return (weekday - 1) * 1440 + hour * 60 + minute;
+}
+
+// Differenza locale - VMC ridotta a [-5040, 5040) minuti
+inline float clock_offset_minutes(float local_minute_of_week, int32_t vmc_minute_of_week)
+{
+  float offset = std::fmod(local_minute_of_week - vmc_minute_of_week, (float)CLOCK_WEEK_MINUTES);
+  if (offset >= CLOCK_WEEK_MINUTES / 2)
+    offset -= CLOCK_WEEK_MINUTES;
+  else if (offset < -CLOCK_WEEK_MINUTES / 2)
+    offset += CLOCK_WEEK_MINUTES;
+  return offset;
+}
+
+class VmcClockSync
+{
+public:
+  // threshold_minutes: errore massimo tollerato
+  // sample_interval_ms: distanza minima tra due campioni usati per la stima
+  // min_samples: campioni necessari (su almeno min_span_ms) per fidarsi della deriva
+  VmcClockSync(float threshold_minutes = 2.0f, uint32_t sample_interval_ms = 1800000, uint8_t min_samples = 6,
+               uint32_t min_span_ms = 6 * 3600000UL)
+      : threshold_(threshold_minutes), sample_interval_ms_(sample_interval_ms), min_samples_(min_samples),
+        min_span_ms_(min_span_ms) {}
+
+  static const size_t MAX_SAMPLES = 48;
+
+  // Campione dall'ultima lettura del Block 8. local_minute_of_week include i
+  // secondi come frazione. Ritorna true se il campione è stato usato.
+  bool add_sample(uint16_t vmc_hour_minute, uint16_t vmc_weekday, float local_minute_of_week, uint32_t now_ms)
+  {
+    // Letture partite prima della scrittura: ancora l'orologio vecchio
+    if (corrections_ > 0 && now_ms - written_ms_ < CLOCK_WRITE_SETTLE_MS)
+      return false;
+
+    int32_t vmc_minute = vmc_clock_minute_of_week(vmc_hour_minute, vmc_weekday);
+    if (vmc_minute < 0)
+    {
+      invalid_clock_ = true; // Registri fuori scala: da correggere subito
+      return false;
+    }
+    invalid_clock_ = false;
+
+    // La VMC mostra il minuto troncato: in media è indietro di mezzo minuto
+    float offset = clock_offset_minutes(local_minute_of_week, vmc_minute) - 0.5f;
+    last_offset_ = offset;
+    has_offset_ = true;
+
+    if (!samples_.empty() && now_ms - samples_.back().time_ms < sample_interval_ms_)
+      return false;
+
+    // Salto rispetto alla retta (orologio cambiato a mano, cambio dell'ora): si riparte
+    if (estimate_ready() && std::fabs(offset - predicted_offset(now_ms)) > 3.0f)
+    {
+      ESP_LOGW("vmc_clock", "Clock jump of %.1f min, drift estimate reset", offset - predicted_offset(now_ms));
+      samples_.clear();
+    }
+
+    if (samples_.size() >= MAX_SAMPLES)
+      samples_.erase(samples_.begin());
+    Sample sample = {now_ms, offset};
+    samples_.push_back(sample);
+    fit();
+    return true;
+  }
+
+  // La correzione va scritta adesso: errore misurato oltre la soglia, oppure
+  // retta oltre la soglia con la misura (risoluzione 1 minuto) che lo conferma
+  bool correction_due(uint32_t now_ms) const
+  {
+    if (invalid_clock_)
+      return true;
+    if (!has_offset_)
+      return false;
+    if (std::fabs(last_offset_) > threshold_)
+      return true;
+    return estimate_ready() && std::fabs(predicted_offset(now_ms)) >= threshold_ &&
+           std::fabs(last_offset_) >= threshold_ - 1.0f;
+  }
+
+  // Millisecondi alla prossima correzione prevista (-1 se non stimabile entro una settimana)
+  int32_t ms_until_correction(uint32_t now_ms) const
+  {
+    if (correction_due(now_ms))
+      return 0;
+    if (!estimate_ready() || slope_ == 0.0f)
+      return -1;
+    float target = slope_ > 0 ? threshold_ : -threshold_;
+    float ms = (target - predicted_offset(now_ms)) / slope_;
+    if (ms < 0 || ms > 7.0f * CLOCK_MS_PER_DAY)
+      return -1;
+    return (int32_t)ms;
+  }
+
+  // Da chiamare dopo ogni lettura del Block 8: true se il momento previsto per
+  // la correzione è cambiato (di almeno un minuto, o comparso/sparito) e il
+  // timer va riarmato con delay_ms (-1 = nessuna correzione prevista, fermarlo)
+  bool schedule(uint32_t now_ms, int32_t &delay_ms)
+  {
+    // Timer già scattato da più di un minuto senza scrittura (misura che non
+    // confermava la previsione): va riarmato
+    if (armed_ && (int32_t)(now_ms - deadline_ms_) > 60000)
+      armed_ = false;
+    delay_ms = ms_until_correction(now_ms);
+    bool armed = delay_ms >= 0;
+    uint32_t deadline_ms = now_ms + (armed ? delay_ms : 0);
+    if (armed == armed_ && (!armed || std::abs((int32_t)(deadline_ms - deadline_ms_)) < 60000))
+      return false;
+    armed_ = armed;
+    deadline_ms_ = deadline_ms;
+    return true;
+  }
+
+  // Dopo la scrittura di 0x0800/0x0801: l'errore riparte da zero, la deriva resta
+  void on_correction_written(uint32_t now_ms)
+  {
+    corrections_++;
+    armed_ = false;
+    written_ms_ = now_ms;
+    has_offset_ = false;
+    last_offset_ = 0.0f;
+    invalid_clock_ = false;
+    float slope = slope_;
+    bool ready = estimate_ready();
+    samples_.clear();
+    // Si conserva la pendenza stimata come punto di partenza
+    if (ready)
+    {
+      carried_slope_ = slope;
+      has_carried_slope_ = true;
+    }
+  }
+
+  bool estimate_ready() const
+  {
+    if (samples_.size() >= min_samples_ && samples_.back().time_ms - samples_.front().time_ms >= min_span_ms_)
+      return true;
+    return has_carried_slope_ && !samples_.empty();
+  }
+
+  // Deriva stimata (minuti al giorno, positiva = VMC in ritardo); NAN se non disponibile
+  float drift_minutes_per_day() const { return estimate_ready() ? slope_ * CLOCK_MS_PER_DAY : NAN; }
+  float last_offset() const { return has_offset_ ? last_offset_ : NAN; }
+  uint32_t corrections() const { return corrections_; }
+
+private:
+  struct Sample
+  {
+    uint32_t time_ms;
+    float offset;
+  };
+
+  float predicted_offset(uint32_t now_ms) const
+  {
+    return intercept_ + slope_ * (float)(int32_t)(now_ms - samples_.front().time_ms);
+  }
+
+  // Minimi quadrati offset = intercept + slope * (t - t0), t in ms
+  void fit()
+  {
+    size_t n = samples_.size();
+    bool enough = n >= min_samples_ && samples_.back().time_ms - samples_.front().time_ms >= min_span_ms_;
+    if (!enough)
+    {
+      // Pochi campioni: pendenza ereditata dall'ultima stima, retta per l'ultimo campione
+      slope_ = has_carried_slope_ ? carried_slope_ : 0.0f;
+      intercept_ = samples_.back().offset - slope_ * (float)(samples_.back().time_ms - samples_.front().time_ms);
+      return;
+    }
+
+    double sum_t = 0, sum_o = 0, sum_tt = 0, sum_to = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+      double t = (double)(samples_[i].time_ms - samples_.front().time_ms);
+      sum_t += t;
+      sum_o += samples_[i].offset;
+      sum_tt += t * t;
+      sum_to += t * samples_[i].offset;
+    }
+    double denominator = n * sum_tt - sum_t * sum_t;
+    slope_ = denominator > 0 ? (float)((n * sum_to - sum_t * sum_o) / denominator) : 0.0f;
+    intercept_ = (float)((sum_o - slope_ * sum_t) / n);
+  }
+
+  float threshold_;
+  uint32_t sample_interval_ms_;
+  uint8_t min_samples_;
+  uint32_t min_span_ms_;
+
+  std::vector<Sample> samples_;
+  float slope_ = 0.0f; // Minuti per ms
+  float intercept_ = 0.0f;
+  float carried_slope_ = 0.0f;
+  bool has_carried_slope_ = false;
+
+  float last_offset_ = 0.0f;
+  bool has_offset_ = false;
+  bool invalid_clock_ = false;
+  uint32_t corrections_ = 0;
+  uint32_t written_ms_ = 0;
+  bool armed_ = false; // Timer della correzione armato da schedule()
+  uint32_t deadline_ms_ = 0;
+};
@@ -0,0 +1,225 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef USE_ESP32
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
+#endif
+
+// ============================================================================
+// Giornale degli allarmi (registro 0x110) in flash
+// ============================================================================
+//
+// Ogni cambiamento della parola di allarme diventa un evento {ora, parola
+// prima/dopo, ore di funzionamento da 0x120}. Gli eventi si accumulano in RAM
+// e vengono scritti in flash a pagine da ALARM_JOURNAL_PAGE_EVENTS eventi:
+// ogni scrittura usa la pagina successiva di un anello di ALARM_JOURNAL_PAGES
+// (solo aggiunte, la più vecchia viene sovrascritta), così le scritture si
+// distribuiscono su tutte le pagine e il giornale ha dimensione fissa.
+//
+// Quando scrivere:
+//   - batch di una pagina pieno, ma non prima di min_flush_interval dalla
+//     scrittura precedente (un allarme che oscilla non consuma la flash);
+//   - eventi in attesa da più di flush_delay (pagina parziale);
+//   - sempre allo spegnimento (flush() senza controllare flush_due()).
+// Se la RAM si riempie prima di poter scrivere si perdono gli eventi più vecchi.
+
+static const uint16_t ALARM_WORD_ADDRESS = 0x0110; // Letto anche da solo dalla sorveglianza allarmi
+static const size_t ALARM_JOURNAL_PAGE_EVENTS = 8;
+static const size_t ALARM_JOURNAL_PAGES = 16;                                  // 128 eventi al massimo
+static const size_t ALARM_JOURNAL_MAX_PENDING = 4 * ALARM_JOURNAL_PAGE_EVENTS; // Batch in RAM
+
+struct AlarmEvent
+{
+  uint32_t timestamp; // Epoch UTC, 0 se l'ora non era valida
+  uint16_t before;
+  uint16_t after;
+  uint32_t hours; // Ore di funzionamento (0x120)
+};
+
+// Pagina in flash: sequence 0 = pagina mai scritta
+struct AlarmJournalPage
+{
+  uint32_t sequence;
+  uint8_t count;
+  uint8_t reserved[3];
+  AlarmEvent events[ALARM_JOURNAL_PAGE_EVENTS];
+};
+
+// Memoria delle pagine (preferenze ESPHome sul dispositivo, mappa nei test)
+class AlarmJournalStorage
+{
+public:
+  virtual ~AlarmJournalStorage() {}
+  virtual bool load(size_t page, AlarmJournalPage &data) = 0;
+  virtual bool save(size_t page, const AlarmJournalPage &data) = 0;
+};
+
+class AlarmJournal
+{
+public:
+  explicit AlarmJournal(uint32_t min_flush_interval_ms = 600000, uint32_t flush_delay_ms = 3600000)
+      : min_flush_interval_ms_(min_flush_interval_ms), flush_delay_ms_(flush_delay_ms), pages_(ALARM_JOURNAL_PAGES) {}
+
+  // Rilegge le pagine salvate; ritorna il numero di eventi ripristinati
+  size_t restore(AlarmJournalStorage *storage)
+  {
+    storage_ = storage;
+    next_slot_ = 0;
+    next_sequence_ = 1;
+    size_t restored = 0;
+    for (size_t slot = 0; slot < ALARM_JOURNAL_PAGES; slot++)
+    {
+      AlarmJournalPage &page = pages_[slot];
+      if (!storage_->load(slot, page) || page.sequence == 0 || page.count == 0 || page.count > ALARM_JOURNAL_PAGE_EVENTS)
+      {
+        page = AlarmJournalPage();
+        continue;
+      }
+      restored += page.count;
+      if (page.sequence >= next_sequence_)
+      {
+        next_sequence_ = page.sequence + 1;
+        next_slot_ = (slot + 1) % ALARM_JOURNAL_PAGES;
+      }
+    }
+    return restored;
+  }
+
+  // Parola di allarme letta dalla VMC; true se è stato registrato un evento.
+  // Ignorata prima di restore(); alla prima lettura si confronta con l'ultimo
+  // evento salvato (0 se non ce ne sono)
+  bool on_alarm_word(uint16_t word, uint32_t timestamp, uint32_t hours, uint32_t now_ms)
+  {
+    if (storage_ == nullptr)
+      return false;
+    if (!has_word_)
+    {
+      std::vector<AlarmEvent> stored = events();
+      word_ = stored.empty() ? 0 : stored.back().after;
+      has_word_ = true;
+    }
+    if (word == word_)
+      return false;
+
+    if (pending_.size() >= ALARM_JOURNAL_MAX_PENDING)
+    {
+      pending_.erase(pending_.begin());
+      dropped_++;
+    }
+    if (pending_.empty())
+      oldest_pending_ms_ = now_ms;
+    pending_.push_back({timestamp, word_, word, hours});
+    word_ = word;
+    return true;
+  }
+
+  bool flush_due(uint32_t now_ms) const
+  {
+    if (pending_.empty())
+      return false;
+    if (now_ms - oldest_pending_ms_ >= flush_delay_ms_)
+      return true;
+    return pending_.size() >= ALARM_JOURNAL_PAGE_EVENTS &&
+           (page_writes_ == 0 || now_ms - last_flush_ms_ >= min_flush_interval_ms_);
+  }
+
+  // Scrive gli eventi in attesa in pagine nuove; false se non c'era nulla da
+  // scrivere o se una pagina non è stata salvata (gli eventi restano in RAM)
+  bool flush(uint32_t now_ms)
+  {
+    if (storage_ == nullptr || pending_.empty())
+      return false;
+    while (!pending_.empty())
+    {
+      AlarmJournalPage page = AlarmJournalPage();
+      page.sequence = next_sequence_;
+      page.count = pending_.size() < ALARM_JOURNAL_PAGE_EVENTS ? pending_.size() : ALARM_JOURNAL_PAGE_EVENTS;
+      for (size_t i = 0; i < page.count; i++)
+        page.events[i] = pending_[i];
+      if (!storage_->save(next_slot_, page))
+        return false;
+
+      pages_[next_slot_] = page;
+      next_slot_ = (next_slot_ + 1) % ALARM_JOURNAL_PAGES;
+      next_sequence_++;
+      page_writes_++;
+      pending_.erase(pending_.begin(), pending_.begin() + page.count);
+    }
+    last_flush_ms_ = now_ms;
+    return true;
+  }
+
+  // Tutti gli eventi, dal più vecchio: pagine salvate e poi quelli in RAM
+  std::vector<AlarmEvent> events() const
+  {
+    std::vector<AlarmEvent> result;
+    for (size_t i = 0; i < ALARM_JOURNAL_PAGES; i++)
+    {
+      const AlarmJournalPage &page = pages_[(next_slot_ + i) % ALARM_JOURNAL_PAGES];
+      if (page.sequence != 0)
+        result.insert(result.end(), page.events, page.events + page.count);
+    }
+    result.insert(result.end(), pending_.begin(), pending_.end());
+    return result;
+  }
+
+  // Ultimi max_events eventi come [[timestamp, prima, dopo, ore], ...]
+  std::string to_json(size_t max_events) const
+  {
+    std::vector<AlarmEvent> all = events();
+    size_t first = all.size() > max_events ? all.size() - max_events : 0;
+    std::string json = "[";
+    char item[64];
+    for (size_t i = first; i < all.size(); i++)
+    {
+      snprintf(item, sizeof(item), "%s[%u,%u,%u,%u]", i > first ? "," : "", (unsigned)all[i].timestamp,
+               (unsigned)all[i].before, (unsigned)all[i].after, (unsigned)all[i].hours);
+      json += item;
+    }
+    return json + "]";
+  }
+
+  size_t pending() const { return pending_.size(); }
+  uint32_t page_writes() const { return page_writes_; }
+  // Eventi persi per RAM piena prima di una scrittura
+  uint32_t dropped() const { return dropped_; }
+
+private:
+  uint32_t min_flush_interval_ms_;
+  uint32_t flush_delay_ms_;
+  AlarmJournalStorage *storage_ = nullptr;
+  std::vector<AlarmJournalPage> pages_; // Copia in RAM delle pagine in flash
+  size_t next_slot_ = 0;
+  uint32_t next_sequence_ = 1;
+  std::vector<AlarmEvent> pending_;
+  uint32_t oldest_pending_ms_ = 0;
+  uint32_t last_flush_ms_ = 0;
+  uint32_t page_writes_ = 0;
+  uint32_t dropped_ = 0;
+  uint16_t word_ = 0;
+  bool has_word_ = false;
+};
+
+#ifdef USE_ESP32
+// Una preferenza ESPHome (NVS) per pagina
+class PreferencesAlarmJournalStorage : public AlarmJournalStorage
+{
+public:
+  PreferencesAlarmJournalStorage()
+  {
+    uint32_t base = esphome::fnv1_hash("vmc_alarm_journal");
+    for (size_t page = 0; page < ALARM_JOURNAL_PAGES; page++)
+      pages_[page] = esphome::global_preferences->make_preference<AlarmJournalPage>(base + page, true);
+  }
+
+  bool load(size_t page, AlarmJournalPage &data) override { return pages_[page].load(&data); }
+  bool save(size_t page, const AlarmJournalPage &data) override { return pages_[page].save(&data); }
+
+private:
+  esphome::ESPPreferenceObject pages_[ALARM_JOURNAL_PAGES];
+};
+#endif
@@ -0,0 +1,207 @@
+#pragma once
+#include <cstdint>
+
+// ============================================================================
+// Controllo locale della ventilazione su richiesta (RH / CO2)
+// ============================================================================
+//
+// Due modalità:
+//   - inoltro: i valori RH/CO2 (sensori locali o da HA) vengono scritti nei
+//     registri External RH (0x30A) e External CO2 (0x30B) e la regolazione
+//     resta alla VMC;
+//   - velocità diretta: il nodo calcola la velocità e scrive Manual speed (0x0309);
+//     serve la modalità Manual (0x0307 = 3), e la modalità precedente torna
+//     all'uscita dalla velocità diretta (ManualModeOverride).
+// In entrambi i casi si scrive solo quando la variazione è significativa
+// (deadband/isteresi) e non più spesso di quanto consentito (rate limit).
+
+static const uint16_t DCV_EXTERNAL_RH_ADDRESS = 0x030A;
+static const uint16_t DCV_EXTERNAL_CO2_ADDRESS = 0x030B;
+static const uint16_t DCV_MANUAL_SPEED_ADDRESS = 0x0309;
+static const uint16_t DCV_MODE_ADDRESS = 0x0307;
+static const uint16_t DCV_MANUAL_MODE = 3; // 0x0307: Manual
+static const uint8_t DCV_MAX_SPEED = 3; // 0x0309: 0-3 (velocità 1-4)
+
+// Confronto robusto all'overflow di millis()
+inline bool dcv_elapsed(uint32_t now_ms, uint32_t since_ms, uint32_t interval_ms)
+{
+  return (uint32_t)(now_ms - since_ms) >= interval_ms;
+}
+
+// Inoltra un valore raw verso un registro della VMC con deadband e rate limit.
+// Un valore che supera la deadband durante l'attesa del rate limit resta in
+// sospeso e viene scritto da flush(); refresh_ms riscrive comunque il valore
+// periodicamente (0 = mai) così la VMC non lavora su un dato vecchio.
+class DeadbandForwarder
+{
+public:
+  DeadbandForwarder(uint16_t deadband, uint32_t min_interval_ms, uint32_t refresh_ms = 0)
+      : deadband_(deadband), min_interval_ms_(min_interval_ms), refresh_ms_(refresh_ms) {}
+
+  // Nuovo campione: ritorna true se va scritto subito (valore in value())
+  bool update(uint16_t raw, uint32_t now_ms)
+  {
+    latest_ = raw;
+    has_latest_ = true;
+    return flush(now_ms);
+  }
+
+  // Da chiamare periodicamente: scrive i valori in sospeso o il refresh
+  bool flush(uint32_t now_ms)
+  {
+    if (!has_latest_)
+      return false;
+
+    bool changed = !has_written_ || distance(latest_, written_) >= deadband_;
+    bool refresh = has_written_ && refresh_ms_ > 0 && dcv_elapsed(now_ms, written_ms_, refresh_ms_);
+    if (!changed && !refresh)
+      return false;
+    if (has_written_ && !refresh && !dcv_elapsed(now_ms, written_ms_, min_interval_ms_))
+      return false; // Rate limit: resta in sospeso
+
+    written_ = latest_;
+    written_ms_ = now_ms;
+    has_written_ = true;
+    writes_++;
+    return true;
+  }
+
+  uint16_t value() const { return written_; }
+  uint32_t writes() const { return writes_; }
+
+  // La VMC è stata riavviata o il valore sovrascritto da altri: riscrivi al prossimo campione
+  void invalidate() { has_written_ = false; }
+
+private:
+  static uint16_t distance(uint16_t a, uint16_t b) { return a > b ? a - b : b - a; }
+
+  uint16_t deadband_;
+  uint32_t min_interval_ms_;
+  uint32_t refresh_ms_;
+
+  uint16_t latest_ = 0;
+  bool has_latest_ = false;
+  uint16_t written_ = 0;
+  bool has_written_ = false;
+  uint32_t written_ms_ = 0;
+  uint32_t writes_ = 0;
+};
+
+// Livello (0-3) di una grandezza con soglie crescenti e isteresi in discesa
+class HysteresisLevel
+{
+public:
+  HysteresisLevel(uint16_t threshold1, uint16_t threshold2, uint16_t threshold3, uint16_t hysteresis)
+      : hysteresis_(hysteresis)
+  {
+    thresholds_[0] = threshold1;
+    thresholds_[1] = threshold2;
+    thresholds_[2] = threshold3;
+  }
+
+  uint8_t update(uint16_t value)
+  {
+    // Salita: basta superare la soglia
+    while (level_ < DCV_MAX_SPEED && value >= thresholds_[level_])
+      level_++;
+    // Discesa: bisogna scendere sotto soglia - isteresi
+    while (level_ > 0 && value + hysteresis_ < thresholds_[level_ - 1])
+      level_--;
+    return level_;
+  }
+
+  uint8_t level() const { return level_; }
+
+private:
+  uint16_t thresholds_[DCV_MAX_SPEED];
+  uint16_t hysteresis_;
+  uint8_t level_ = 0;
+};
+
+// Calcola la velocità manuale (0-3) dal massimo tra livello CO2 e livello RH.
+// Gli aumenti sono consentiti dopo min_up_ms, le riduzioni dopo min_down_ms
+// (salita rapida, discesa lenta: evita pendolamenti della ventola).
+class DemandSpeedController
+{
+public:
+  DemandSpeedController(const HysteresisLevel &co2, const HysteresisLevel &rh,
+                        uint32_t min_up_ms = 30000, uint32_t min_down_ms = 600000)
+      : co2_(co2), rh_(rh), min_up_ms_(min_up_ms), min_down_ms_(min_down_ms) {}
+
+  // co2_ppm: ppm; rh_x10: umidità relativa in decimi di %, come nel registro 0x30A
+  void set_co2(uint16_t co2_ppm) { co2_.update(co2_ppm); has_input_ = true; }
+  void set_rh(uint16_t rh_x10) { rh_.update(rh_x10); has_input_ = true; }
+
+  // Ritorna true se la velocità deve essere scritta (valore in speed())
+  bool evaluate(uint32_t now_ms)
+  {
+    if (!has_input_)
+      return false;
+
+    uint8_t target = co2_.level() > rh_.level() ? co2_.level() : rh_.level();
+    if (has_speed_ && target == speed_)
+      return false;
+
+    if (has_speed_)
+    {
+      uint32_t wait = target > speed_ ? min_up_ms_ : min_down_ms_;
+      if (!dcv_elapsed(now_ms, changed_ms_, wait))
+        return false;
+    }
+
+    speed_ = target;
+    has_speed_ = true;
+    changed_ms_ = now_ms;
+    return true;
+  }
+
+  uint8_t speed() const { return speed_; }
+  void invalidate() { has_speed_ = false; }
+
+private:
+  HysteresisLevel co2_;
+  HysteresisLevel rh_;
+  uint32_t min_up_ms_;
+  uint32_t min_down_ms_;
+
+  bool has_input_ = false;
+  bool has_speed_ = false;
+  uint8_t speed_ = 0;
+  uint32_t changed_ms_ = 0;
+};
+
+// Modalità della VMC sovrascritta con Manual per la velocità diretta. I modi
+// sono i valori di 0x0307 letti dal Block 3, -1 se non ancora letti.
+class ManualModeOverride
+{
+public:
+  // Entrata in velocità diretta: salva la modalità attiva; true se va scritto Manual
+  bool enter(int mode)
+  {
+    if (active_)
+      return false;
+    active_ = true;
+    saved_ = mode == (int)DCV_MANUAL_MODE ? -1 : mode;
+    return true;
+  }
+
+  // Uscita: true se va riscritta la modalità salvata (saved_mode()). Non la
+  // riscrive se nel frattempo l'utente ha scelto una terza modalità; la lettura
+  // può essere ancora quella precedente a Manual, e allora riscriverla è innocuo
+  bool leave(int mode)
+  {
+    if (!active_)
+      return false;
+    active_ = false;
+    if (saved_ < 0)
+      return false;
+    return mode < 0 || mode == (int)DCV_MANUAL_MODE || mode == saved_;
+  }
+
+  bool active() const { return active_; }
+  int saved_mode() const { return saved_; }
+
+private:
+  bool active_ = false;
+  int saved_ = -1;
+};
@@ -0,0 +1,191 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// ============================================================================
+// Arbitraggio del bus tra letture di stato e letture massive
+// ============================================================================
+//
+// I controller sabiana_vmc e sabiana_vmc_schedules condividono bus e slave: una
+// lettura dei programmi orari (4 x 119 registri) teneva il bus per circa un
+// secondo davanti a comandi e polling. Le letture passano quindi da qui, un
+// frame alla volta, in ordine di classe di priorità. Le letture BULK sono
+// divise in blocchi da bulk_chunk_registers registri: tra un blocco e l'altro
+// passa qualsiasi lavoro di classe superiore. I comandi utente (scritture
+// accodate sui controller) non passano dall'arbitro ma lo bloccano: finché
+// una coda non è vuota non viene inviato nessun frame (bus_busy di next()).
+
+enum class BusPriority : uint8_t
+{
+  USER = 0, // Letture richieste da un comando utente (es. rilettura di conferma)
+  ALARM,    // Sorveglianza allarmi: solo 0x0110, tra un round di polling e l'altro
+  STATE,    // Polling dei blocchi di stato (Block 0-3, 8)
+  BULK,     // Programmi orari e letture massive, interrompibili tra i blocchi
+  COUNT
+};
+
+struct ArbiterChunk
+{
+  BusPriority priority;
+  uint16_t start;
+  uint16_t count;
+};
+
+class ModbusArbiter
+{
+public:
+  // ok = false se un blocco della lettura non ha avuto risposta valida
+  typedef std::function<void(bool, uint16_t, const std::vector<uint8_t> &)> ReadCallback;
+
+  static const size_t MAX_QUEUED_PER_CLASS = 8;
+
+  ModbusArbiter(uint16_t bulk_chunk_registers = 30, uint32_t response_timeout_ms = 2000)
+      : bulk_chunk_registers_(bulk_chunk_registers), response_timeout_ms_(response_timeout_ms) {}
+
+  // Accoda una lettura; false se già in coda o se la classe è piena
+  bool submit_read(BusPriority priority, uint16_t start, uint16_t count, ReadCallback callback)
+  {
+    std::vector<PendingRead> &queue = queues_[(uint8_t)priority];
+    if (count == 0 || queue.size() >= MAX_QUEUED_PER_CLASS)
+      return false;
+    for (size_t i = 0; i < queue.size(); i++)
+      if (queue[i].start == start && queue[i].count == count)
+        return false;
+
+    PendingRead read;
+    read.start = start;
+    read.count = count;
+    read.done = 0;
+    read.callback = callback;
+    queue.push_back(read);
+    return true;
+  }
+
+  // Prossimo frame da inviare, se il bus è libero e non c'è un frame in volo
+  bool next(uint32_t now_ms, bool bus_busy, ArbiterChunk &chunk)
+  {
+    if (in_flight_)
+    {
+      if (now_ms - sent_ms_ < response_timeout_ms_)
+        return false;
+      ESP_LOGW("modbus_arbiter", "No response for 0x%04X, read dropped", in_flight_chunk_.start);
+      timeouts_++;
+      finish(false);
+    }
+    if (bus_busy)
+      return false;
+
+    for (uint8_t p = 0; p < (uint8_t)BusPriority::COUNT; p++)
+    {
+      if (queues_[p].empty())
+        continue;
+      const PendingRead &read = queues_[p].front();
+      uint16_t remaining = read.count - read.done;
+      chunk.priority = (BusPriority)p;
+      chunk.start = read.start + read.done;
+      chunk.count = (chunk.priority == BusPriority::BULK && remaining > bulk_chunk_registers_) ? bulk_chunk_registers_ : remaining;
+
+      // Una lettura massiva iniziata che cede il passo
+      const std::vector<PendingRead> &bulk = queues_[(uint8_t)BusPriority::BULK];
+      if (p < (uint8_t)BusPriority::BULK && !bulk.empty() && bulk.front().done > 0)
+        preemptions_++;
+
+      in_flight_ = true;
+      in_flight_chunk_ = chunk;
+      sent_ms_ = now_ms;
+      frames_sent_++;
+      return true;
+    }
+    return false;
+  }
+
+  // Risposta al frame frame_id (vedi frame_id()); ignorata se tardiva
+  void on_response(uint32_t frame_id, const std::vector<uint8_t> &data)
+  {
+    if (!in_flight_ || frame_id != frames_sent_)
+      return;
+    if (data.size() != in_flight_chunk_.count * 2u)
+    {
+      finish(false);
+      return;
+    }
+    PendingRead &read = queues_[(uint8_t)in_flight_chunk_.priority].front();
+    read.data.insert(read.data.end(), data.begin(), data.end());
+    read.done += in_flight_chunk_.count;
+    if (read.done < read.count)
+    {
+      in_flight_ = false; // Il resto della lettura torna in arbitraggio
+      return;
+    }
+    finish(true);
+  }
+
+  bool in_flight() const { return in_flight_; }
+  // Identificativo dell'ultimo frame concesso da next()
+  uint32_t frame_id() const { return frames_sent_; }
+  bool idle() const
+  {
+    if (in_flight_)
+      return false;
+    for (uint8_t p = 0; p < (uint8_t)BusPriority::COUNT; p++)
+      if (!queues_[p].empty())
+        return false;
+    return true;
+  }
+  size_t queued(BusPriority priority) const { return queues_[(uint8_t)priority].size(); }
+  uint32_t preemptions() const { return preemptions_; }
+  uint32_t timeouts() const { return timeouts_; }
+
+private:
+  struct PendingRead
+  {
+    uint16_t start;
+    uint16_t count;
+    uint16_t done;
+    std::vector<uint8_t> data;
+    ReadCallback callback;
+  };
+
+  // Chiude la lettura del frame in volo; la callback può accodare altre letture
+  void finish(bool ok)
+  {
+    std::vector<PendingRead> &queue = queues_[(uint8_t)in_flight_chunk_.priority];
+    PendingRead read = queue.front();
+    queue.erase(queue.begin());
+    in_flight_ = false;
+    if (read.callback)
+      read.callback(ok, read.start, read.data);
+  }
+
+  uint16_t bulk_chunk_registers_;
+  uint32_t response_timeout_ms_;
+
+  std::vector<PendingRead> queues_[(uint8_t)BusPriority::COUNT];
+  bool in_flight_ = false;
+  ArbiterChunk in_flight_chunk_;
+  uint32_t sent_ms_ = 0;
+  uint32_t frames_sent_ = 0;
+
+  uint32_t preemptions_ = 0;
+  uint32_t timeouts_ = 0;
+};
+
+// Invia il prossimo frame concesso dall'arbitro sul controller indicato.
+// Da chiamare spesso (interval breve): il ritmo dei blocchi BULK dipende da qui
+inline bool modbus_arbiter_dispatch(ModbusArbiter &arbiter, modbus_controller::ModbusController *controller,
+                                    uint32_t now_ms, bool bus_busy)
+{
+  ArbiterChunk chunk;
+  if (!arbiter.next(now_ms, bus_busy, chunk))
+    return false;
+
+  ModbusArbiter *self = &arbiter;
+  uint32_t frame_id = arbiter.frame_id();
+  auto cmd = modbus_controller::ModbusCommandItem::create_read_command(
+      controller, modbus_controller::ModbusRegisterType::HOLDING, chunk.start, chunk.count,
+      [self, frame_id](modbus_controller::ModbusRegisterType, uint16_t, const std::vector<uint8_t> &data)
+      { self->on_response(frame_id, data); });
+  controller->queue_command(cmd);
+  return true;
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <cstdint>
+
+// ============================================================================
+// Passaggio gestito della velocità del bus (parametro "MB Uart speed")
+// ============================================================================
+//
+// Il bit 3 del registro 0x0200 (Block 2) seleziona la velocità della porta
+// Modbus della VMC: 0 = 9600, 1 = 38400 bps. La procedura:
+//   1. scrive il bit a 9600 (unica velocità sicuramente condivisa);
+//   2. dopo settle_ms riconfigura modbus_uart a 38400 e invia un probe;
+//   3. senza risposta alterna i probe tra 38400 e 9600 (probe_attempts per velocità);
+//   4. se la VMC risponde solo a 9600 ha rifiutato il cambio: il bit viene
+//      ripristinato; se non risponde a nessuna velocità si torna a 9600.
+// Con il link offline hunt_baud() alterna la velocità dei probe, così il nodo
+// ritrova la VMC anche se al riavvio questa è rimasta a 38400.
+
+static const uint32_t MODBUS_BAUD_SLOW = 9600;
+static const uint32_t MODBUS_BAUD_FAST = 38400;
+static const uint16_t MB_UART_SPEED_ADDRESS = 0x0200;
+static const uint16_t MB_UART_SPEED_MASK = 1 << 3;
+
+// Frame RTU più lungo (256 byte) e tempo di risposta della VMC
+static const uint32_t MODBUS_MAX_FRAME_BYTES = 256;
+static const uint32_t MODBUS_TURNAROUND_MS = 40;
+
+// send_wait_time per una velocità: trasmissione del frame più lungo
+// (10 bit per carattere) + tempo di risposta, arrotondato ai 10 ms.
+// A 9600 bps vale 310 ms, il valore storico di modbus.yaml.
+inline uint16_t modbus_send_wait_ms(uint32_t baud)
+{
+  uint32_t frame_ms = (MODBUS_MAX_FRAME_BYTES * 10 * 1000 + baud - 1) / baud;
+  uint32_t wait_ms = frame_ms + MODBUS_TURNAROUND_MS;
+  return (uint16_t)((wait_ms + 9) / 10 * 10);
+}
+
+// Azione richiesta ad ogni tick
+enum class BaudAction : uint8_t
+{
+  NONE,
+  WRITE_FLAGS, // Scrivere flags_value() in 0x0200 (alla velocità corrente)
+  APPLY_BAUD   // Riconfigurare modbus_uart a uart_baud() e inviare un probe
+};
+
+enum class BaudUpgradeResult : uint8_t
+{
+  NONE,
+  UPGRADED,   // La VMC risponde a 38400
+  REJECTED,   // La VMC risponde solo a 9600: bit ripristinato
+  NO_RESPONSE // Nessuna risposta a nessuna velocità: tornati a 9600
+};
+
+class ModbusBaudManager
+{
+public:
+  ModbusBaudManager(uint32_t settle_ms = 2000, uint32_t probe_timeout_ms = 3000, uint8_t probe_attempts = 3)
+      : settle_ms_(settle_ms), probe_timeout_ms_(probe_timeout_ms), probe_attempts_(probe_attempts) {}
+
+  // Avvia il passaggio a 38400; flags = valore attuale di 0x0200
+  bool start_upgrade(uint16_t flags)
+  {
+    if (busy() || uart_baud_ == MODBUS_BAUD_FAST)
+      return false;
+    flags_ = flags | MB_UART_SPEED_MASK;
+    phase_ = Phase::WRITE;
+    result_ = BaudUpgradeResult::NONE;
+    ESP_LOGI("modbus_baud", "Starting UART speed upgrade to %u bps", MODBUS_BAUD_FAST);
+    return true;
+  }
+
+  BaudAction next_action(uint32_t now_ms)
+  {
+    switch (phase_)
+    {
+    case Phase::WRITE:
+      phase_ = Phase::SETTLE;
+      deadline_ms_ = now_ms + settle_ms_;
+      return BaudAction::WRITE_FLAGS;
+
+    case Phase::SETTLE:
+      if (!reached(now_ms, deadline_ms_))
+        return BaudAction::NONE;
+      phase_ = Phase::PROBE;
+      attempts_ = 0;
+      return probe_at(MODBUS_BAUD_FAST, now_ms);
+
+    case Phase::PROBE:
+      if (!reached(now_ms, deadline_ms_))
+        return BaudAction::NONE;
+      if (++attempts_ < probe_attempts_ * 2)
+        return probe_at(uart_baud_ == MODBUS_BAUD_FAST ? MODBUS_BAUD_SLOW : MODBUS_BAUD_FAST, now_ms);
+      // Nessuna risposta: si resta a 9600 e ci pensa il circuit breaker
+      phase_ = Phase::IDLE;
+      result_ = BaudUpgradeResult::NO_RESPONSE;
+      ESP_LOGE("modbus_baud", "No answer at any speed, falling back to %u bps", MODBUS_BAUD_SLOW);
+      uart_baud_ = MODBUS_BAUD_SLOW;
+      return BaudAction::APPLY_BAUD;
+
+    case Phase::REVERT:
+      phase_ = Phase::IDLE;
+      return BaudAction::WRITE_FLAGS;
+
+    default:
+      return BaudAction::NONE;
+    }
+  }
+
+  // Risposta al probe inviato dopo APPLY_BAUD
+  void on_probe_response()
+  {
+    if (phase_ != Phase::PROBE)
+      return;
+    if (uart_baud_ == MODBUS_BAUD_FAST)
+    {
+      phase_ = Phase::IDLE;
+      result_ = BaudUpgradeResult::UPGRADED;
+      ESP_LOGI("modbus_baud", "VMC answering at %u bps", MODBUS_BAUD_FAST);
+    }
+    else
+    {
+      // La VMC è rimasta a 9600: riallinea il parametro
+      flags_ &= ~MB_UART_SPEED_MASK;
+      phase_ = Phase::REVERT;
+      result_ = BaudUpgradeResult::REJECTED;
+      ESP_LOGW("modbus_baud", "VMC still at %u bps, reverting MB Uart speed", MODBUS_BAUD_SLOW);
+    }
+  }
+
+  // Link offline: velocità da usare per il prossimo probe del circuit breaker
+  uint32_t hunt_baud()
+  {
+    if (!busy())
+      uart_baud_ = uart_baud_ == MODBUS_BAUD_FAST ? MODBUS_BAUD_SLOW : MODBUS_BAUD_FAST;
+    return uart_baud_;
+  }
+
+  bool busy() const { return phase_ != Phase::IDLE; }
+  uint32_t uart_baud() const { return uart_baud_; }
+  uint16_t flags_value() const { return flags_; }
+  BaudUpgradeResult result() const { return result_; }
+
+private:
+  enum class Phase : uint8_t
+  {
+    IDLE,
+    WRITE,
+    SETTLE,
+    PROBE,
+    REVERT
+  };
+
+  static bool reached(uint32_t now_ms, uint32_t deadline_ms) { return (int32_t)(now_ms - deadline_ms) >= 0; }
+
+  BaudAction probe_at(uint32_t baud, uint32_t now_ms)
+  {
+    uart_baud_ = baud;
+    deadline_ms_ = now_ms + probe_timeout_ms_;
+    return BaudAction::APPLY_BAUD;
+  }
+
+  uint32_t settle_ms_;
+  uint32_t probe_timeout_ms_;
+  uint8_t probe_attempts_;
+
+  Phase phase_ = Phase::IDLE;
+  uint32_t uart_baud_ = MODBUS_BAUD_SLOW;
+  uint16_t flags_ = 0;
+  uint32_t deadline_ms_ = 0;
+  uint8_t attempts_ = 0;
+  BaudUpgradeResult result_ = BaudUpgradeResult::NONE;
+};
@@ -0,0 +1,303 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef USE_ESP32
+#include <esp_heap_caps.h>
+#endif
+
+// ============================================================================
+// Cattura dei frame RTU grezzi in un buffer circolare (PSRAM)
+// ============================================================================
+//
+// I blocchi di byte visti dalla debug sequence di modbus_uart (un blocco per
+// silenzio di fine frame) vengono salvati con tempo e direzione in un buffer
+// circolare allocato in PSRAM alla prima scrittura: a buffer pieno si perdono i
+// frame più vecchi. export_file() produce il file binario scaricabile da
+// /vmc/capture.bin, parse_rtu_capture() lo rilegge (tests/replay_capture.cpp).
+//
+// Il download legge direttamente dal buffer a pezzi (begin_export /
+// export_chunk / end_export), senza copiarlo: durante un download la cattura
+// è congelata e i nuovi frame vengono scartati (skipped_frames). Il mutex
+// serve perché il server web gira in un altro task rispetto alla UART.
+//
+// Formato del file (little-endian):
+//   [0-3]  magic 'R' 'T' 'U' 'C'
+//   [4]    versione (RTU_CAPTURE_VERSION)
+//   [5-8]  numero di frame
+//   poi per ogni frame, dal più vecchio:
+//   [0-3]  millis() alla ricezione
+//   [4]    direzione (0 = RX, 1 = TX)
+//   [5-6]  lunghezza N
+//   [7-]   N byte del frame
+
+static const uint8_t RTU_CAPTURE_VERSION = 1;
+static const size_t RTU_CAPTURE_HEADER_SIZE = 9;
+static const size_t RTU_CAPTURE_RECORD_HEADER_SIZE = 7;
+static const size_t RTU_CAPTURE_MAX_FRAME = 256; // Frame RTU massimo
+static const char *const VMC_CAPTURE_PATH = "/vmc/capture.bin";
+
+enum class CaptureDirection : uint8_t
+{
+  RX = 0,
+  TX = 1
+};
+
+struct CapturedFrame
+{
+  uint32_t time_ms;
+  CaptureDirection direction;
+  std::vector<uint8_t> data;
+};
+
+class RtuCapture
+{
+public:
+  explicit RtuCapture(size_t capacity_bytes = 256 * 1024) : capacity_(capacity_bytes) {}
+  RtuCapture(const RtuCapture &other) : capacity_(other.capacity_) { copy_from(other); }
+  RtuCapture &operator=(const RtuCapture &other)
+  {
+    if (this != &other)
+    {
+      release();
+      capacity_ = other.capacity_;
+      copy_from(other);
+    }
+    return *this;
+  }
+  ~RtuCapture() { release(); }
+
+  // Salva un frame; false se troppo lungo o se il buffer non è allocabile
+  bool add(CaptureDirection direction, const uint8_t *data, size_t length, uint32_t now_ms)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (exporting_)
+    {
+      skipped_frames_++;
+      return false;
+    }
+    size_t record = RTU_CAPTURE_RECORD_HEADER_SIZE + length;
+    if (length == 0 || length > RTU_CAPTURE_MAX_FRAME || record > capacity_ || !allocate())
+      return false;
+
+    while (used_ + record > capacity_)
+      drop_oldest();
+
+    uint8_t header[RTU_CAPTURE_RECORD_HEADER_SIZE] = {
+        (uint8_t)now_ms, (uint8_t)(now_ms >> 8), (uint8_t)(now_ms >> 16), (uint8_t)(now_ms >> 24),
+        (uint8_t)direction, (uint8_t)length, (uint8_t)(length >> 8)};
+    put(header, sizeof(header));
+    put(data, length);
+    frames_++;
+    return true;
+  }
+
+  bool add(CaptureDirection direction, const std::vector<uint8_t> &data, uint32_t now_ms)
+  {
+    return add(direction, data.data(), data.size(), now_ms);
+  }
+
+  // Ignorata durante un download
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!exporting_)
+      reset();
+  }
+
+  size_t frames() const { return frames_; }
+  size_t used_bytes() const { return used_; }
+  size_t capacity() const { return capacity_; }
+  // Frame persi per far posto ai nuovi
+  uint32_t dropped_frames() const { return dropped_frames_; }
+  // Frame scartati perché arrivati durante un download
+  uint32_t skipped_frames() const { return skipped_frames_; }
+  bool exporting() const { return exporting_; }
+
+  // Congela la cattura per un download; false se ce n'è già uno in corso.
+  // size = dimensione del file
+  bool begin_export(size_t &size)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (exporting_)
+      return false;
+    exporting_ = true;
+    size = RTU_CAPTURE_HEADER_SIZE + used_;
+    return true;
+  }
+
+  // Copia in out al massimo max byte del file a partire da offset; ritorna i
+  // byte copiati (0 = fine del file)
+  size_t export_chunk(size_t offset, uint8_t *out, size_t max) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint8_t header[RTU_CAPTURE_HEADER_SIZE] = {
+        'R', 'T', 'U', 'C', RTU_CAPTURE_VERSION,
+        (uint8_t)frames_, (uint8_t)(frames_ >> 8), (uint8_t)(frames_ >> 16), (uint8_t)(frames_ >> 24)};
+    size_t copied = 0;
+    for (; copied < max && offset + copied < RTU_CAPTURE_HEADER_SIZE; copied++)
+      out[copied] = header[offset + copied];
+    for (; copied < max && offset + copied < RTU_CAPTURE_HEADER_SIZE + used_; copied++)
+      out[copied] = buffer_[(head_ + offset + copied - RTU_CAPTURE_HEADER_SIZE) % capacity_];
+    return copied;
+  }
+
+  void end_export()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exporting_ = false;
+  }
+
+  // File binario con tutti i frame in memoria, dal più vecchio
+  std::vector<uint8_t> export_file() const
+  {
+    std::vector<uint8_t> file(RTU_CAPTURE_HEADER_SIZE + used_);
+    file.resize(export_chunk(0, file.data(), file.size()));
+    return file;
+  }
+
+private:
+  bool allocate()
+  {
+    if (buffer_ != nullptr)
+      return true;
+#ifdef USE_ESP32
+    buffer_ = (uint8_t *)heap_caps_malloc(capacity_, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+    if (buffer_ == nullptr)
+      buffer_ = (uint8_t *)malloc(capacity_);
+    return buffer_ != nullptr;
+  }
+
+  void release()
+  {
+    free(buffer_); // heap_caps_malloc e malloc condividono free() su ESP-IDF
+    buffer_ = nullptr;
+    reset();
+  }
+
+  void reset()
+  {
+    head_ = 0;
+    used_ = 0;
+    frames_ = 0;
+    dropped_frames_ = 0;
+  }
+
+  void copy_from(const RtuCapture &other)
+  {
+    std::lock_guard<std::mutex> lock(other.mutex_);
+    head_ = other.head_;
+    used_ = other.used_;
+    frames_ = other.frames_;
+    dropped_frames_ = other.dropped_frames_;
+    if (other.buffer_ != nullptr && allocate())
+      memcpy(buffer_, other.buffer_, capacity_);
+  }
+
+  uint8_t at(size_t offset) const { return buffer_[(head_ + offset) % capacity_]; }
+
+  void put(const uint8_t *data, size_t length)
+  {
+    for (size_t i = 0; i < length; i++)
+      buffer_[(head_ + used_ + i) % capacity_] = data[i];
+    used_ += length;
+  }
+
+  void drop_oldest()
+  {
+    size_t length = at(5) | (at(6) << 8);
+    size_t record = RTU_CAPTURE_RECORD_HEADER_SIZE + length;
+    head_ = (head_ + record) % capacity_;
+    used_ -= record;
+    frames_--;
+    dropped_frames_++;
+  }
+
+  size_t capacity_;
+  uint8_t *buffer_ = nullptr;
+  size_t head_ = 0; // Primo byte del frame più vecchio
+  size_t used_ = 0;
+  size_t frames_ = 0;
+  uint32_t dropped_frames_ = 0;
+  uint32_t skipped_frames_ = 0;
+  bool exporting_ = false;
+  mutable std::mutex mutex_;
+};
+
+// Rilegge un file di export_file(); false se il file non è valido o è troncato
+inline bool parse_rtu_capture(const std::vector<uint8_t> &file, std::vector<CapturedFrame> &frames)
+{
+  frames.clear();
+  if (file.size() < RTU_CAPTURE_HEADER_SIZE || file[0] != 'R' || file[1] != 'T' || file[2] != 'U' || file[3] != 'C' ||
+      file[4] != RTU_CAPTURE_VERSION)
+    return false;
+
+  uint32_t count = file[5] | (file[6] << 8) | (file[7] << 16) | ((uint32_t)file[8] << 24);
+  size_t offset = RTU_CAPTURE_HEADER_SIZE;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (offset + RTU_CAPTURE_RECORD_HEADER_SIZE > file.size())
+      return false;
+    CapturedFrame frame;
+    frame.time_ms = file[offset] | (file[offset + 1] << 8) | (file[offset + 2] << 16) | ((uint32_t)file[offset + 3] << 24);
+    frame.direction = file[offset + 4] == 1 ? CaptureDirection::TX : CaptureDirection::RX;
+    size_t length = file[offset + 5] | (file[offset + 6] << 8);
+    offset += RTU_CAPTURE_RECORD_HEADER_SIZE;
+    if (offset + length > file.size())
+      return false;
+    frame.data.assign(file.begin() + offset, file.begin() + offset + length);
+    offset += length;
+    frames.push_back(frame);
+  }
+  return offset == file.size();
+}
+
+#ifdef USE_WEBSERVER
+#include <memory>
+#include "esphome/components/web_server_base/web_server_base.h"
+
+// GET /vmc/capture.bin: scarica la cattura corrente
+class RtuCaptureHttpHandler : public AsyncWebHandler
+{
+public:
+  explicit RtuCaptureHttpHandler(RtuCapture *capture) : capture_(capture) {}
+
+  bool canHandle(AsyncWebServerRequest *request) override
+  {
+    return request->method() == HTTP_GET && request->url() == VMC_CAPTURE_PATH;
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override
+  {
+    size_t size;
+    if (!capture_->begin_export(size))
+    {
+      request->send(503, "text/plain", "Capture download already in progress");
+      return;
+    }
+    // La cattura resta congelata finché la risposta esiste: il guard viene
+    // distrutto con la risposta, anche se il client si disconnette prima
+    std::shared_ptr<ExportGuard> guard = std::make_shared<ExportGuard>(capture_);
+    AsyncWebServerResponse *response = request->beginResponse(
+        "application/octet-stream", size,
+        [guard](uint8_t *buffer, size_t max, size_t index) -> size_t
+        { return guard->capture->export_chunk(index, buffer, max); });
+    response->addHeader("Content-Disposition", "attachment; filename=\"capture.bin\"");
+    request->send(response);
+  }
+
+private:
+  struct ExportGuard
+  {
+    explicit ExportGuard(RtuCapture *capture) : capture(capture) {}
+    ~ExportGuard() { capture->end_export(); }
+    RtuCapture *capture;
+  };
+
+  RtuCapture *capture_;
+};
+#endif
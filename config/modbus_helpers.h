@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <cstdio>
 #include <string>
 #include <vector>
 
@@ -48,17 +50,83 @@ enum class Scale {
     THOUSANDTH = 3 // *0.001
 };
 
+// Divisori esatti per Scale: una divisione per 10^n invece di n moltiplicazioni per 0.1
+static const float SCALE_DIVISORS[] = {1.0f, 10.0f, 100.0f, 1000.0f};
+
 // Funzione per leggere un valore signed 16-bit e convertirlo in float con scala
 // data: vettore contenente i dati Modbus raw
 // offset: posizione di partenza nel vettore (in byte)
 // scale: scala da applicare al valore (UNITY, DECIMAL, CENTESIMAL, THOUSANDTH)
 auto readSigned16ToFloat = [](const std::vector<uint8_t>& data, unsigned int offset, Scale scale) -> float {
     int16_t raw = (int16_t)((data[offset] << 8) | data[offset + 1]);
-    float scale_factor = 1.0f;
-    for (int i = 0; i < (int)scale; i++) {
-        scale_factor *= 0.1f;
+    return raw / SCALE_DIVISORS[(int)scale];
+};
+
+// 10^n calcolato a compile time
+constexpr int32_t pow10i(int n) {
+    return n == 0 ? 1 : 10 * pow10i(n - 1);
+}
+
+// Valore a virgola fissa: intero del registro con esponente di scala fisso
+// (DECIMALS = 1 per i decimi di grado della VMC). Decodifica, clamp, confronto
+// e formattazione restano interi; to_float() solo al momento della pubblicazione
+template <int DECIMALS>
+struct Fixed16 {
+    static constexpr int32_t SCALE = pow10i(DECIMALS);
+    int32_t raw;
+
+    // Registro signed 16-bit big-endian
+    static Fixed16 decode(const std::vector<uint8_t>& data, unsigned int offset) {
+        return Fixed16{(int16_t)((data[offset] << 8) | data[offset + 1])};
+    }
+    // Valore intero in unità (es. -40 °C -> raw -400)
+    static constexpr Fixed16 units(int32_t value) {
+        return Fixed16{value * SCALE};
+    }
+
+    Fixed16 clamp(Fixed16 min_value, Fixed16 max_value) const {
+        return raw < min_value.raw ? min_value : (raw > max_value.raw ? max_value : *this);
+    }
+    float to_float() const {
+        return raw / (float)SCALE;
+    }
+    // "-12.3" senza passare dal float; ritorna la lunghezza scritta
+    int format(char *buffer, size_t size) const {
+        int32_t absolute = raw < 0 ? -raw : raw;
+        if (DECIMALS == 0) {
+            return snprintf(buffer, size, "%s%d", raw < 0 ? "-" : "", (int)absolute);
+        }
+        return snprintf(buffer, size, "%s%d.%0*d", raw < 0 ? "-" : "", (int)(absolute / SCALE), DECIMALS,
+                        (int)(absolute % SCALE));
+    }
+
+    bool operator==(const Fixed16& other) const { return raw == other.raw; }
+    bool operator!=(const Fixed16& other) const { return raw != other.raw; }
+    bool operator<(const Fixed16& other) const { return raw < other.raw; }
+    bool operator>(const Fixed16& other) const { return raw > other.raw; }
+};
+
+template <int DECIMALS>
+constexpr int32_t Fixed16<DECIMALS>::SCALE;
+
+// Pubblicazione solo ai cambiamenti, con confronto esatto tra valori interi
+template <int DECIMALS>
+class FixedChange {
+public:
+    // true se value è il primo valore o è diverso dall'ultimo accettato
+    bool changed(Fixed16<DECIMALS> value) {
+        if (has_value_ && value == last_) {
+            return false;
+        }
+        last_ = value;
+        has_value_ = true;
+        return true;
     }
-    return raw * scale_factor;
+    void reset() { has_value_ = false; }
+
+private:
+    Fixed16<DECIMALS> last_{0};
+    bool has_value_ = false;
 };
 
 auto readFloat = [](const std::vector<uint8_t>& data, unsigned int offset) -> float {
@@ -159,4 +227,27 @@ auto readNBitsFromUns16(const std::vector<uint8_t>& data, unsigned int offset, u
              offset/2 + 0x100, register_value, bit_position, num_bits, mask, result);
     
     return result;
-}
\ No newline at end of file
+}
+
+// Funzione per calcolare il CRC16 Modbus RTU (polinomio 0xA001, valore iniziale 0xFFFF)
+// data: vettore contenente i byte su cui calcolare il CRC
+// offset: posizione di partenza nel vettore (in byte)
+// length: numero di byte da considerare
+// Nel frame RTU il CRC viene trasmesso con il byte basso per primo
+auto modbusCrc16 = [](const std::vector<uint8_t>& data, size_t offset, size_t length) -> uint16_t {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = offset; i < offset + length && i < data.size(); i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return crc;
+};
+
+// Intervallo di registri scritto con un frame FC16 (indirizzo del primo registro e valori)
+struct WriteRange
+{
+    uint16_t address;
+    std::vector<uint16_t> values;
+};
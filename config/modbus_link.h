@@ -0,0 +1,238 @@
+#pragma once
+#include <cstdint>
+
+// Stato del collegamento RS-485 verso la VMC
+enum class LinkState : uint8_t
+{
+  ONLINE,   // Ultimo round completo andato a buon fine
+  DEGRADED, // Round falliti o parziali, ma sotto la soglia del circuit breaker
+  OFFLINE   // Circuito aperto: solo probe del registro VMC_LINK_PROBE_ADDRESS
+};
+
+// Azione richiesta dal monitor ad ogni tick
+enum class LinkAction : uint8_t
+{
+  NONE,  // Nulla da fare
+  POLL,  // Avviare un round di lettura completo (controller->update())
+  PROBE  // Inviare la lettura singola di VMC_LINK_PROBE_ADDRESS
+};
+
+// Blocchi letti dal controller principale in ogni round
+enum VmcLinkBlock : uint8_t
+{
+  LINK_BLK0 = 0,
+  LINK_BLK1,
+  LINK_BLK2,
+  LINK_BLK3,
+  LINK_BLOCK_COUNT
+};
+
+// Primo registro del Block 0: lettura minima per verificare che la VMC risponda
+static const uint16_t VMC_LINK_PROBE_ADDRESS = 0x0000;
+
+// Circuit breaker per il polling Modbus.
+// Il polling del controller non è più periodico ma viene deciso da next_action():
+//   - con il link attivo viene avviato un round ogni poll_interval_ms;
+//   - un round senza nessun blocco valido entro round_timeout_ms è un fallimento;
+//   - dopo failure_threshold fallimenti consecutivi il circuito si apre e si
+//     inviano solo probe, con backoff esponenziale fino a max_backoff_ms;
+//   - alla prima risposta (probe o blocco) il circuito si chiude e parte subito un round.
+// Tutti i tempi sono passati dall'esterno (millis()) per poter simulare il bus nei test.
+class ModbusLinkMonitor
+{
+public:
+  ModbusLinkMonitor(uint8_t failure_threshold = 3,
+                    uint32_t poll_interval_ms = 30000,
+                    uint32_t round_timeout_ms = 10000,
+                    uint32_t base_backoff_ms = 5000,
+                    uint32_t max_backoff_ms = 300000)
+      : failure_threshold_(failure_threshold),
+        poll_interval_ms_(poll_interval_ms),
+        round_timeout_ms_(round_timeout_ms),
+        base_backoff_ms_(base_backoff_ms),
+        max_backoff_ms_(max_backoff_ms),
+        backoff_ms_(base_backoff_ms)
+  {
+    for (int i = 0; i < LINK_BLOCK_COUNT; i++)
+      block_failures_[i] = 0;
+  }
+
+  // Da chiamare periodicamente (es. ogni secondo): ritorna l'azione da eseguire
+  LinkAction next_action(uint32_t now_ms)
+  {
+    if (round_active_ && elapsed(now_ms, round_started_ms_) >= round_timeout_ms_)
+      close_round(now_ms);
+
+    if (state_ == LinkState::OFFLINE)
+    {
+      if (probe_active_)
+      {
+        if (elapsed(now_ms, probe_sent_ms_) < round_timeout_ms_)
+          return LinkAction::NONE;
+
+        // Nessuna risposta al probe: raddoppia l'attesa
+        probe_active_ = false;
+        backoff_ms_ = (backoff_ms_ > max_backoff_ms_ / 2) ? max_backoff_ms_ : backoff_ms_ * 2;
+        next_probe_ms_ = now_ms + backoff_ms_;
+        ESP_LOGD("vmc_link", "Probe timeout, next probe in %u ms", backoff_ms_);
+        return LinkAction::NONE;
+      }
+
+      if (!reached(now_ms, next_probe_ms_))
+        return LinkAction::NONE;
+
+      probe_active_ = true;
+      probe_sent_ms_ = now_ms;
+      probes_sent_++;
+      return LinkAction::PROBE;
+    }
+
+    if (round_active_ || (polled_once_ && !reached(now_ms, next_poll_ms_)))
+      return LinkAction::NONE;
+
+    round_active_ = true;
+    polled_once_ = true;
+    round_started_ms_ = now_ms;
+    round_ok_mask_ = 0;
+    next_poll_ms_ = now_ms + poll_interval_ms_;
+    rounds_started_++;
+    return LinkAction::POLL;
+  }
+
+  // Esito della decodifica di un blocco (lambda del sensore modbus_controller)
+  void on_block_result(uint8_t block, bool ok, uint32_t now_ms)
+  {
+    if (block >= LINK_BLOCK_COUNT)
+      return;
+
+    if (!ok)
+    {
+      if (block_failures_[block] < UINT16_MAX)
+        block_failures_[block]++;
+      return;
+    }
+
+    block_failures_[block] = 0;
+    round_ok_mask_ |= (1 << block);
+
+    // Risposta tardiva mentre il circuito è aperto: il link è tornato
+    if (state_ == LinkState::OFFLINE)
+      recover(now_ms);
+
+    if (round_active_ && round_ok_mask_ == ALL_BLOCKS_MASK)
+      close_round(now_ms);
+  }
+
+  // Risposta valida al probe: chiude il circuito e anticipa il prossimo round
+  void on_probe_response(uint32_t now_ms)
+  {
+    probe_active_ = false;
+    if (state_ == LinkState::OFFLINE)
+      recover(now_ms);
+  }
+
+  LinkState state() const { return state_; }
+  bool is_online() const { return state_ != LinkState::OFFLINE; }
+  uint32_t current_backoff_ms() const { return backoff_ms_; }
+  uint8_t consecutive_failures() const { return consecutive_failures_; }
+  uint16_t block_failures(uint8_t block) const { return block < LINK_BLOCK_COUNT ? block_failures_[block] : 0; }
+  uint32_t rounds_started() const { return rounds_started_; }
+  uint32_t probes_sent() const { return probes_sent_; }
+
+  // Ritorna true (una sola volta) se lo stato è cambiato dall'ultima chiamata
+  bool consume_state_change()
+  {
+    bool changed = state_changed_;
+    state_changed_ = false;
+    return changed;
+  }
+
+  // Ritorna true (una sola volta) se un round si è chiuso, completo o per
+  // round_timeout_ms: il chiamante pubblica il round parziale (VmcState::commit)
+  bool consume_round_closed()
+  {
+    bool closed = round_closed_;
+    round_closed_ = false;
+    return closed;
+  }
+
+private:
+  static const uint8_t ALL_BLOCKS_MASK = (1 << LINK_BLOCK_COUNT) - 1;
+
+  static uint32_t elapsed(uint32_t now_ms, uint32_t since_ms) { return now_ms - since_ms; }
+  // Confronto robusto all'overflow di millis()
+  static bool reached(uint32_t now_ms, uint32_t deadline_ms) { return (int32_t)(now_ms - deadline_ms) >= 0; }
+
+  void set_state(LinkState state)
+  {
+    if (state_ != state)
+    {
+      state_ = state;
+      state_changed_ = true;
+    }
+  }
+
+  void close_round(uint32_t now_ms)
+  {
+    round_active_ = false;
+    round_closed_ = true;
+
+    if (round_ok_mask_ != 0)
+    {
+      consecutive_failures_ = 0;
+      set_state(round_ok_mask_ == ALL_BLOCKS_MASK ? LinkState::ONLINE : LinkState::DEGRADED);
+      return;
+    }
+
+    consecutive_failures_++;
+    ESP_LOGW("vmc_link", "Poll round failed (%u/%u)", consecutive_failures_, failure_threshold_);
+    if (consecutive_failures_ < failure_threshold_)
+    {
+      set_state(LinkState::DEGRADED);
+      return;
+    }
+
+    ESP_LOGW("vmc_link", "VMC not responding, switching to probe mode");
+    set_state(LinkState::OFFLINE);
+    backoff_ms_ = base_backoff_ms_;
+    next_probe_ms_ = now_ms + backoff_ms_;
+    probe_active_ = false;
+  }
+
+  void recover(uint32_t now_ms)
+  {
+    ESP_LOGI("vmc_link", "VMC responding again");
+    consecutive_failures_ = 0;
+    backoff_ms_ = base_backoff_ms_;
+    round_active_ = false;
+    probe_active_ = false;
+    next_poll_ms_ = now_ms; // Round immediato al prossimo tick
+    set_state(LinkState::DEGRADED);
+  }
+
+  uint8_t failure_threshold_;
+  uint32_t poll_interval_ms_;
+  uint32_t round_timeout_ms_;
+  uint32_t base_backoff_ms_;
+  uint32_t max_backoff_ms_;
+
+  LinkState state_ = LinkState::ONLINE;
+  bool state_changed_ = false;
+  uint8_t consecutive_failures_ = 0;
+  uint16_t block_failures_[LINK_BLOCK_COUNT];
+
+  bool polled_once_ = false;
+  bool round_active_ = false;
+  uint32_t round_started_ms_ = 0;
+  uint32_t next_poll_ms_ = 0;
+  uint8_t round_ok_mask_ = 0;
+  bool round_closed_ = false;
+
+  bool probe_active_ = false;
+  uint32_t probe_sent_ms_ = 0;
+  uint32_t next_probe_ms_ = 0;
+  uint32_t backoff_ms_;
+
+  uint32_t rounds_started_ = 0;
+  uint32_t probes_sent_ = 0;
+};
@@ -0,0 +1,233 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// Sniffer passivo del traffico RTU di altri master (pannello a parete Sabiana)
+// ============================================================================
+//
+// Riceve i byte visti dalla UART (debug sequence di modbus_uart), ricostruisce
+// i frame validando il CRC e abbina ogni richiesta di lettura del pannello alla
+// risposta della VMC. Le risposte che coprono interi blocchi noti (Block 0-8,
+// vedi VMC_REGISTER_BLOCKS) vengono restituite per essere decodificate come se
+// le avessimo lette noi. Le risposte alle nostre richieste vengono ignorate
+// (on_own_request), i dati arrivano già dal modbus_controller.
+// observed() dice se un blocco è stato letto di recente dal pannello: in quel
+// caso il polling del nodo lo salta.
+
+// Età massima di un blocco letto dal pannello perché il polling lo salti (= intervallo di polling)
+static const uint32_t VMC_SNIFFER_MAX_AGE_MS = 30000;
+
+struct SniffedRead
+{
+  uint16_t start;
+  std::vector<uint8_t> data; // Registri big-endian, data.size() = count * 2
+};
+
+class ModbusRtuSniffer
+{
+public:
+  // frame_gap_ms: silenzio oltre il quale i byte in attesa sono un frame troncato
+  ModbusRtuSniffer(uint8_t slave_address = 1, uint32_t frame_gap_ms = 20)
+      : slave_address_(slave_address), frame_gap_ms_(frame_gap_ms)
+  {
+    for (size_t i = 0; i < VMC_REGISTER_BLOCK_COUNT; i++)
+    {
+      seen_[i] = false;
+      seen_ms_[i] = 0;
+    }
+  }
+
+  // Nostra richiesta in uscita (direzione TX): la prossima risposta non va decodificata
+  void on_own_request()
+  {
+    own_pending_ = true;
+    pending_ = false;
+  }
+
+  // Byte ricevuti: aggiunge a out i blocchi completi letti dal pannello
+  size_t feed(const std::vector<uint8_t> &bytes, uint32_t now_ms, std::vector<SniffedRead> &out)
+  {
+    if (!buffer_.empty() && now_ms - last_byte_ms_ > frame_gap_ms_)
+    {
+      dropped_bytes_ += buffer_.size();
+      buffer_.clear();
+    }
+    last_byte_ms_ = now_ms;
+    buffer_.insert(buffer_.end(), bytes.begin(), bytes.end());
+
+    size_t before = out.size();
+    while (buffer_.size() >= 4)
+    {
+      size_t length = 0;
+      Frame kind = parse(length);
+      if (kind == Frame::INCOMPLETE)
+        break;
+      if (kind == Frame::INVALID)
+      {
+        // Nessun frame valido in questa posizione: risincronizza sul byte successivo
+        buffer_.erase(buffer_.begin());
+        dropped_bytes_++;
+        continue;
+      }
+      frames_++;
+      if (buffer_[0] == slave_address_)
+        dispatch(kind, now_ms, out);
+      buffer_.erase(buffer_.begin(), buffer_.begin() + length);
+    }
+    if (buffer_.size() > 256)
+    {
+      dropped_bytes_ += buffer_.size();
+      buffer_.clear();
+    }
+    return out.size() - before;
+  }
+
+  // Il pannello ha letto tutto l'intervallo indicato da meno di max_age_ms
+  bool observed(uint16_t start, uint16_t count, uint32_t now_ms, uint32_t max_age_ms) const
+  {
+    for (size_t i = 0; i < VMC_REGISTER_BLOCK_COUNT; i++)
+    {
+      const VmcRegisterBlock &block = VMC_REGISTER_BLOCKS[i];
+      if (start >= block.start && (uint32_t)start + count <= (uint32_t)block.start + block.count)
+        return seen_[i] && now_ms - seen_ms_[i] < max_age_ms;
+    }
+    return false;
+  }
+
+  uint32_t frames() const { return frames_; }
+  uint32_t decoded_blocks() const { return decoded_blocks_; }
+  uint32_t dropped_bytes() const { return dropped_bytes_; }
+
+private:
+  enum class Frame : uint8_t
+  {
+    INCOMPLETE,
+    INVALID,
+    READ_REQUEST,
+    READ_RESPONSE,
+    OTHER // Scritture, eco ed eccezioni: validi ma senza dati da decodificare
+  };
+
+  bool crc_ok(size_t length) const
+  {
+    uint16_t crc = buffer_[length - 2] | (buffer_[length - 1] << 8);
+    return modbusCrc16(buffer_, 0, length - 2) == crc;
+  }
+
+  // Prova le lunghezze possibili per il codice funzione in testa al buffer
+  Frame try_lengths(const size_t *lengths, const Frame *kinds, size_t count, size_t &length) const
+  {
+    bool waiting = false;
+    for (size_t i = 0; i < count; i++)
+    {
+      if (lengths[i] == 0)
+        continue;
+      if (buffer_.size() < lengths[i])
+      {
+        waiting = true;
+        continue;
+      }
+      if (crc_ok(lengths[i]))
+      {
+        length = lengths[i];
+        return kinds[i];
+      }
+    }
+    return waiting ? Frame::INCOMPLETE : Frame::INVALID;
+  }
+
+  Frame parse(size_t &length) const
+  {
+    uint8_t function = buffer_[1];
+    if (function & 0x80)
+    {
+      size_t lengths[] = {5};
+      Frame kinds[] = {Frame::OTHER};
+      return try_lengths(lengths, kinds, 1, length);
+    }
+    switch (function)
+    {
+    case 0x03:
+    case 0x04:
+    {
+      // La risposta è più corta della richiesta solo con byte count 0 (non valido)
+      size_t lengths[] = {8, buffer_[2] > 0 ? 5u + buffer_[2] : 0};
+      Frame kinds[] = {Frame::READ_REQUEST, Frame::READ_RESPONSE};
+      return try_lengths(lengths, kinds, 2, length);
+    }
+    case 0x06:
+    {
+      size_t lengths[] = {8};
+      Frame kinds[] = {Frame::OTHER};
+      return try_lengths(lengths, kinds, 1, length);
+    }
+    case 0x10:
+    {
+      size_t lengths[] = {8, buffer_.size() >= 7 ? 9u + buffer_[6] : 9u};
+      Frame kinds[] = {Frame::OTHER, Frame::OTHER};
+      return try_lengths(lengths, kinds, 2, length);
+    }
+    default:
+      return Frame::INVALID;
+    }
+  }
+
+  void dispatch(Frame kind, uint32_t now_ms, std::vector<SniffedRead> &out)
+  {
+    if (kind == Frame::READ_REQUEST)
+    {
+      // Richiesta di un altro master
+      pending_ = true;
+      own_pending_ = false;
+      pending_function_ = buffer_[1];
+      pending_start_ = (buffer_[2] << 8) | buffer_[3];
+      pending_count_ = (buffer_[4] << 8) | buffer_[5];
+      return;
+    }
+    if (kind != Frame::READ_RESPONSE)
+      return;
+
+    bool ours = own_pending_;
+    own_pending_ = false;
+    if (ours || !pending_)
+      return;
+    pending_ = false;
+    if (buffer_[1] != pending_function_ || buffer_[2] != pending_count_ * 2 || pending_function_ != 0x03)
+      return;
+
+    // Un blocco noto per ogni intervallo interamente contenuto nella lettura
+    for (size_t i = 0; i < VMC_REGISTER_BLOCK_COUNT; i++)
+    {
+      const VmcRegisterBlock &block = VMC_REGISTER_BLOCKS[i];
+      if (block.start < pending_start_ || (uint32_t)block.start + block.count > (uint32_t)pending_start_ + pending_count_)
+        continue;
+      size_t offset = 3 + (block.start - pending_start_) * 2;
+      SniffedRead read;
+      read.start = block.start;
+      read.data.assign(buffer_.begin() + offset, buffer_.begin() + offset + block.count * 2);
+      out.push_back(read);
+      seen_[i] = true;
+      seen_ms_[i] = now_ms;
+      decoded_blocks_++;
+    }
+  }
+
+  uint8_t slave_address_;
+  uint32_t frame_gap_ms_;
+  std::vector<uint8_t> buffer_;
+  uint32_t last_byte_ms_ = 0;
+
+  bool pending_ = false;
+  bool own_pending_ = false;
+  uint8_t pending_function_ = 0;
+  uint16_t pending_start_ = 0;
+  uint16_t pending_count_ = 0;
+
+  bool seen_[VMC_REGISTER_BLOCK_COUNT];
+  uint32_t seen_ms_[VMC_REGISTER_BLOCK_COUNT];
+
+  uint32_t frames_ = 0;
+  uint32_t decoded_blocks_ = 0;
+  uint32_t dropped_bytes_ = 0;
+};
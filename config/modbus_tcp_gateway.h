@@ -0,0 +1,501 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// ============================================================================
+// Gateway Modbus TCP servito dalla cache dei registri
+// ============================================================================
+//
+// Le letture (FC03/FC04) di 0x0000-0x0801 vengono servite dalle ultime immagini
+// lette dal bus seriale, senza traffico RS-485. Le scritture (FC06/FC16) nei
+// blocchi scrivibili vengono inoltrate alla VMC e la risposta parte solo a
+// scrittura riletta (WriteDone): eco della richiesta se i registri coincidono,
+// altrimenti un'eccezione. I registri gestiti dal nodo (VMC_TCP_OWNED_REGISTERS)
+// non sono scrivibili da TCP.
+// Freschezza: gli input register da VMC_TCP_AGE_ADDRESS contengono, per ogni
+// intervallo della cache, i secondi dall'ultimo aggiornamento (0xFFFF = mai letto).
+
+static const uint16_t VMC_TCP_PORT = 502;
+static const uint16_t VMC_TCP_AGE_ADDRESS = 0x1000;
+
+// Codici di eccezione Modbus
+static const uint8_t MODBUS_EXCEPTION_ILLEGAL_FUNCTION = 0x01;
+static const uint8_t MODBUS_EXCEPTION_ILLEGAL_ADDRESS = 0x02;
+static const uint8_t MODBUS_EXCEPTION_ILLEGAL_VALUE = 0x03;
+static const uint8_t MODBUS_EXCEPTION_DEVICE_FAILURE = 0x04;
+static const uint8_t MODBUS_EXCEPTION_TARGET_NO_RESPONSE = 0x0B;
+
+// Blocchi della mappa Modbus della VMC (0x0000-0x0801)
+struct VmcRegisterBlock
+{
+  uint16_t start;
+  uint16_t count;
+  bool writable;
+};
+
+static const VmcRegisterBlock VMC_REGISTER_BLOCKS[] = {
+    {0x0000, 14, false},  // Block 0
+    {0x0100, 35, false},  // Block 1
+    {0x0200, 51, true},   // Block 2
+    {0x0300, 17, true},   // Block 3
+    {0x0400, 119, true},  // Block 4
+    {0x0500, 119, true},  // Block 5
+    {0x0600, 119, true},  // Block 6
+    {0x0700, 119, true},  // Block 7
+    {0x0800, 2, true},    // Block 8
+};
+static const size_t VMC_REGISTER_BLOCK_COUNT = sizeof(VMC_REGISTER_BLOCKS) / sizeof(VMC_REGISTER_BLOCKS[0]);
+
+// Registri scritti solo dal nodo: 0x0200 contiene i flag della velocità del bus
+// (ModbusBaudManager, una scrittura esterna farebbe perdere il link), Block 8
+// l'orologio corretto da VmcClockSync
+struct VmcOwnedRegisters
+{
+  uint16_t start;
+  uint16_t count;
+};
+
+static const VmcOwnedRegisters VMC_TCP_OWNED_REGISTERS[] = {
+    {0x0200, 1}, // Flag di Block 2 e velocità del bus (modbus_baud.h)
+    {0x0800, 2}, // Block 8 (Blk8_TimeAndDay.h)
+};
+
+struct CachedRange
+{
+  uint16_t start;
+  uint16_t count;
+  bool writable;
+  bool valid;
+  uint32_t updated_ms;
+  std::vector<uint8_t> image;
+};
+
+// Immagini raw dei blocchi della VMC con l'istante dell'ultimo aggiornamento
+class ModbusRegisterCache
+{
+public:
+  ModbusRegisterCache()
+  {
+    for (size_t i = 0; i < VMC_REGISTER_BLOCK_COUNT; i++)
+      add_range(VMC_REGISTER_BLOCKS[i].start, VMC_REGISTER_BLOCKS[i].count, VMC_REGISTER_BLOCKS[i].writable);
+  }
+
+  // Risposta di un blocco (o parte di esso) ricevuta dal bus
+  bool update(uint16_t start, const std::vector<uint8_t> &data, uint32_t now_ms)
+  {
+    CachedRange *range = find(start, data.size() / 2);
+    if (range == nullptr || data.size() % 2 != 0)
+      return false;
+    std::memcpy(&range->image[(start - range->start) * 2], data.data(), data.size());
+    // Un intervallo è valido solo quando è stato letto tutto almeno una volta
+    if (start == range->start && data.size() == range->image.size())
+      range->valid = true;
+    range->updated_ms = now_ms;
+    return true;
+  }
+
+  bool update_register(uint16_t address, uint16_t value, uint32_t now_ms)
+  {
+    std::vector<uint8_t> data = {(uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+    return update(address, data, now_ms);
+  }
+
+  // Legge count registri in out (big-endian); 0 oppure codice di eccezione
+  uint8_t read(uint16_t start, uint16_t count, std::vector<uint8_t> &out) const
+  {
+    const CachedRange *range = find(start, count);
+    if (range == nullptr)
+      return MODBUS_EXCEPTION_ILLEGAL_ADDRESS;
+    if (!range->valid)
+      return MODBUS_EXCEPTION_TARGET_NO_RESPONSE;
+    size_t offset = (start - range->start) * 2;
+    out.insert(out.end(), range->image.begin() + offset, range->image.begin() + offset + count * 2);
+    return 0;
+  }
+
+  bool writable(uint16_t start, uint16_t count) const
+  {
+    const CachedRange *range = find(start, count);
+    if (range == nullptr || !range->writable)
+      return false;
+    for (const VmcOwnedRegisters &owned : VMC_TCP_OWNED_REGISTERS)
+      if (start < owned.start + owned.count && (uint32_t)start + count > owned.start)
+        return false;
+    return true;
+  }
+
+  // Secondi dall'ultimo aggiornamento dell'intervallo index (0xFFFF = mai)
+  uint16_t age_s(size_t index, uint32_t now_ms) const
+  {
+    if (index >= ranges_.size() || !ranges_[index].valid)
+      return 0xFFFF;
+    uint32_t age = (now_ms - ranges_[index].updated_ms) / 1000;
+    return age > 0xFFFE ? 0xFFFE : age;
+  }
+
+  size_t range_count() const { return ranges_.size(); }
+  const CachedRange &range(size_t index) const { return ranges_[index]; }
+
+private:
+  void add_range(uint16_t start, uint16_t count, bool writable)
+  {
+    CachedRange range;
+    range.start = start;
+    range.count = count;
+    range.writable = writable;
+    range.valid = false;
+    range.updated_ms = 0;
+    range.image.assign(count * 2, 0);
+    ranges_.push_back(range);
+  }
+
+  CachedRange *find(uint16_t start, uint16_t count)
+  {
+    return const_cast<CachedRange *>(static_cast<const ModbusRegisterCache *>(this)->find(start, count));
+  }
+
+  const CachedRange *find(uint16_t start, uint16_t count) const
+  {
+    if (count == 0)
+      return nullptr;
+    for (size_t i = 0; i < ranges_.size(); i++)
+    {
+      const CachedRange &range = ranges_[i];
+      if (start >= range.start && (uint32_t)start + count <= (uint32_t)range.start + range.count)
+        return &range;
+    }
+    return nullptr;
+  }
+
+  std::vector<CachedRange> ranges_;
+};
+
+// Protocollo Modbus TCP (MBAP + PDU) sopra la cache, indipendente dai socket
+class ModbusTcpGateway
+{
+public:
+  // Esito di una scrittura inoltrata: 0 oppure codice di eccezione
+  typedef std::function<void(uint8_t)> WriteDone;
+  // Scrittura da inoltrare alla VMC: indirizzo iniziale, valori e callback da
+  // chiamare una volta sola a scrittura confermata o fallita
+  typedef std::function<void(uint16_t, const std::vector<uint16_t> &, WriteDone)> WriteForwarder;
+  // Frame MBAP completo di una risposta differita
+  typedef std::function<void(const std::vector<uint8_t> &)> ResponseSender;
+
+  ModbusTcpGateway(const ModbusRegisterCache *cache, WriteForwarder forward_write)
+      : cache_(cache), forward_write_(forward_write) {}
+
+  // Elabora il primo frame completo in buffer e aggiunge la risposta a response;
+  // la risposta alle scritture arriva invece più tardi da deferred.
+  // Ritorna i byte consumati (0 = frame incompleto, attendere altri dati)
+  size_t handle(const std::vector<uint8_t> &buffer, std::vector<uint8_t> &response, uint32_t now_ms,
+                ResponseSender deferred = nullptr)
+  {
+    if (buffer.size() < 8)
+      return 0;
+    uint16_t length = (buffer[4] << 8) | buffer[5];
+    if (length < 2 || length > 254)
+      return buffer.size(); // Frame non valido: scarta tutto il buffer
+    size_t frame_size = 6 + length;
+    if (buffer.size() < frame_size)
+      return 0;
+
+    requests_++;
+    std::vector<uint8_t> pdu;
+    if (process(buffer.data(), &buffer[7], length - 1, pdu, now_ms, deferred))
+      append_frame(buffer.data(), pdu, response);
+    return frame_size;
+  }
+
+  uint32_t requests() const { return requests_; }
+  uint32_t forwarded_writes() const { return forwarded_writes_; }
+  uint32_t failed_writes() const { return failed_writes_; }
+
+private:
+  static uint16_t word(const uint8_t *data) { return (data[0] << 8) | data[1]; }
+
+  // MBAP: transaction id e unit id ripresi dalla richiesta, protocol id = 0
+  static void append_frame(const uint8_t *mbap, const std::vector<uint8_t> &pdu, std::vector<uint8_t> &response)
+  {
+    response.push_back(mbap[0]);
+    response.push_back(mbap[1]);
+    response.push_back(0);
+    response.push_back(0);
+    response.push_back((pdu.size() + 1) >> 8);
+    response.push_back((pdu.size() + 1) & 0xFF);
+    response.push_back(mbap[6]);
+    response.insert(response.end(), pdu.begin(), pdu.end());
+  }
+
+  static bool exception(uint8_t function, uint8_t code, std::vector<uint8_t> &pdu)
+  {
+    pdu.clear();
+    pdu.push_back(function | 0x80);
+    pdu.push_back(code);
+    return true;
+  }
+
+  // false se la risposta è differita (scrittura inoltrata)
+  bool process(const uint8_t *mbap, const uint8_t *request, size_t size, std::vector<uint8_t> &pdu, uint32_t now_ms,
+               ResponseSender deferred)
+  {
+    uint8_t function = request[0];
+    switch (function)
+    {
+    case 0x03: // Read holding registers
+    case 0x04: // Read input registers
+    {
+      if (size != 5)
+        return exception(function, MODBUS_EXCEPTION_ILLEGAL_VALUE, pdu);
+      uint16_t start = word(&request[1]);
+      uint16_t count = word(&request[3]);
+      if (count == 0 || count > 125)
+        return exception(function, MODBUS_EXCEPTION_ILLEGAL_VALUE, pdu);
+
+      pdu.push_back(function);
+      pdu.push_back(count * 2);
+      uint8_t error = function == 0x04 && start >= VMC_TCP_AGE_ADDRESS ? read_ages(start, count, pdu, now_ms)
+                                                                      : cache_->read(start, count, pdu);
+      if (error != 0)
+        return exception(function, error, pdu);
+      return true;
+    }
+
+    case 0x06: // Write single register
+    {
+      if (size != 5)
+        return exception(function, MODBUS_EXCEPTION_ILLEGAL_VALUE, pdu);
+      uint16_t address = word(&request[1]);
+      if (!cache_->writable(address, 1))
+        return exception(function, MODBUS_EXCEPTION_ILLEGAL_ADDRESS, pdu);
+      return forward(mbap, request, address, std::vector<uint16_t>{word(&request[3])}, pdu, deferred);
+    }
+
+    case 0x10: // Write multiple registers
+    {
+      if (size < 6)
+        return exception(function, MODBUS_EXCEPTION_ILLEGAL_VALUE, pdu);
+      uint16_t start = word(&request[1]);
+      uint16_t count = word(&request[3]);
+      uint8_t bytes = request[5];
+      if (count == 0 || count > 123 || bytes != count * 2 || size != 6u + bytes)
+        return exception(function, MODBUS_EXCEPTION_ILLEGAL_VALUE, pdu);
+      if (!cache_->writable(start, count))
+        return exception(function, MODBUS_EXCEPTION_ILLEGAL_ADDRESS, pdu);
+      std::vector<uint16_t> values;
+      for (uint16_t i = 0; i < count; i++)
+        values.push_back(word(&request[6 + i * 2]));
+      return forward(mbap, request, start, values, pdu, deferred);
+    }
+
+    default:
+      return exception(function, MODBUS_EXCEPTION_ILLEGAL_FUNCTION, pdu);
+    }
+  }
+
+  uint8_t read_ages(uint16_t start, uint16_t count, std::vector<uint8_t> &pdu, uint32_t now_ms) const
+  {
+    if ((uint32_t)start + count > VMC_TCP_AGE_ADDRESS + cache_->range_count())
+      return MODBUS_EXCEPTION_ILLEGAL_ADDRESS;
+    for (uint16_t i = 0; i < count; i++)
+    {
+      uint16_t age = cache_->age_s(start - VMC_TCP_AGE_ADDRESS + i, now_ms);
+      pdu.push_back(age >> 8);
+      pdu.push_back(age & 0xFF);
+    }
+    return 0;
+  }
+
+  // Inoltra la scrittura; la risposta (eco dei primi 5 byte della PDU o
+  // eccezione) parte da deferred quando il forwarder chiama WriteDone
+  bool forward(const uint8_t *mbap, const uint8_t *request, uint16_t start, const std::vector<uint16_t> &values,
+               std::vector<uint8_t> &pdu, ResponseSender deferred)
+  {
+    if (!forward_write_ || !deferred)
+      return exception(request[0], MODBUS_EXCEPTION_TARGET_NO_RESPONSE, pdu);
+
+    forwarded_writes_++;
+    ModbusTcpGateway *self = this;
+    std::vector<uint8_t> header(mbap, mbap + 7);
+    std::vector<uint8_t> echo(request, request + 5);
+    forward_write_(start, values, [self, header, echo, deferred](uint8_t code)
+                   {
+                     std::vector<uint8_t> reply = echo;
+                     if (code != 0)
+                     {
+                       self->failed_writes_++;
+                       exception(echo[0], code, reply);
+                     }
+                     std::vector<uint8_t> response;
+                     append_frame(header.data(), reply, response);
+                     deferred(response);
+                   });
+    return false;
+  }
+
+  const ModbusRegisterCache *cache_;
+  WriteForwarder forward_write_;
+  uint32_t requests_ = 0;
+  uint32_t forwarded_writes_ = 0;
+  uint32_t failed_writes_ = 0;
+};
+
+#ifdef USE_ESP32
+#include <memory>
+#include "esphome/components/socket/socket.h"
+
+// Server TCP non bloccante: da chiamare spesso (interval breve) con loop().
+// Durante una scrittura inoltrata non si leggono altre richieste di quel
+// client; senza esito entro WRITE_TIMEOUT_MS la connessione viene chiusa
+class ModbusTcpServer
+{
+public:
+  static const size_t MAX_CLIENTS = 4;
+  static const uint32_t WRITE_TIMEOUT_MS = 10000;
+
+  explicit ModbusTcpServer(ModbusTcpGateway *gateway, uint16_t port = VMC_TCP_PORT) : gateway_(gateway), port_(port) {}
+
+  void loop(uint32_t now_ms)
+  {
+    if (!listener_ && !start())
+      return;
+
+    // Nuove connessioni
+    while (clients_.size() < MAX_CLIENTS)
+    {
+      struct sockaddr_storage address;
+      socklen_t length = sizeof(address);
+      auto socket = listener_->accept((struct sockaddr *)&address, &length);
+      if (!socket)
+        break;
+      socket->setblocking(false);
+      std::shared_ptr<Client> client = std::make_shared<Client>();
+      client->socket = std::move(socket);
+      clients_.push_back(client);
+      ESP_LOGI("modbus_tcp", "Client connected (%d active)", clients_.size());
+    }
+
+    for (size_t i = 0; i < clients_.size();)
+    {
+      if (serve(clients_[i], now_ms))
+      {
+        i++;
+        continue;
+      }
+      clients_.erase(clients_.begin() + i);
+      ESP_LOGI("modbus_tcp", "Client disconnected (%d active)", clients_.size());
+    }
+  }
+
+private:
+  struct Client
+  {
+    std::unique_ptr<esphome::socket::Socket> socket;
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> pending; // Risposte non ancora accettate dal socket
+    bool awaiting = false;        // Scrittura inoltrata senza ancora un esito
+    uint32_t awaiting_ms = 0;
+    uint32_t deferred_responses = 0;
+  };
+
+  bool start()
+  {
+    listener_ = esphome::socket::socket_ip(SOCK_STREAM, 0);
+    if (!listener_)
+      return false;
+    int enable = 1;
+    listener_->setsockopt(SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    listener_->setblocking(false);
+
+    struct sockaddr_storage address;
+    socklen_t length = esphome::socket::set_sockaddr_any((struct sockaddr *)&address, sizeof(address), port_);
+    if (listener_->bind((struct sockaddr *)&address, length) != 0 || listener_->listen(MAX_CLIENTS) != 0)
+    {
+      ESP_LOGE("modbus_tcp", "Cannot listen on port %d", port_);
+      listener_.reset();
+      return false;
+    }
+    ESP_LOGI("modbus_tcp", "Listening on port %d", port_);
+    return true;
+  }
+
+  // Ritorna false se il client va chiuso
+  bool serve(const std::shared_ptr<Client> &shared, uint32_t now_ms)
+  {
+    Client &client = *shared;
+    // Finché il client non ha ricevuto le risposte precedenti non si leggono
+    // nuove richieste: un client lento non fa crescere il buffer
+    if (!flush(client))
+      return false;
+    if (client.awaiting)
+    {
+      if (now_ms - client.awaiting_ms < WRITE_TIMEOUT_MS)
+        return true;
+      ESP_LOGW("modbus_tcp", "No outcome for a forwarded write, closing client");
+      return false;
+    }
+    if (!client.pending.empty())
+      return true;
+
+    uint8_t chunk[128];
+    ssize_t received = client.socket->read(chunk, sizeof(chunk));
+    if (received == 0)
+      return false;
+    if (received < 0 && errno != EWOULDBLOCK && errno != EAGAIN)
+      return false;
+    // Senza nuovi dati si elaborano le richieste rimaste dopo una scrittura
+    if (received > 0)
+      client.buffer.insert(client.buffer.end(), chunk, chunk + received);
+
+    // Il client può essere chiuso prima dell'esito: la risposta differita
+    // tiene solo un weak_ptr
+    std::weak_ptr<Client> weak = shared;
+    auto deferred = [weak](const std::vector<uint8_t> &response)
+    {
+      std::shared_ptr<Client> c = weak.lock();
+      if (!c)
+        return;
+      c->pending.insert(c->pending.end(), response.begin(), response.end());
+      c->awaiting = false;
+      c->deferred_responses++;
+    };
+
+    while (!client.awaiting)
+    {
+      uint32_t answered = client.deferred_responses;
+      size_t consumed = gateway_->handle(client.buffer, client.pending, now_ms, deferred);
+      if (consumed == 0)
+        break;
+      client.buffer.erase(client.buffer.begin(), client.buffer.begin() + consumed);
+      if (gateway_->forwarded_writes() != forwarded_)
+      {
+        // Scrittura inoltrata: attesa dell'esito, se non è già arrivato
+        forwarded_ = gateway_->forwarded_writes();
+        client.awaiting = client.deferred_responses == answered;
+        client.awaiting_ms = now_ms;
+      }
+    }
+    return flush(client);
+  }
+
+  // Scrive quanto accetta il socket; il resto riparte al loop successivo
+  bool flush(Client &client)
+  {
+    if (client.pending.empty())
+      return true;
+    ssize_t written = client.socket->write(client.pending.data(), client.pending.size());
+    if (written < 0)
+      return errno == EWOULDBLOCK || errno == EAGAIN;
+    client.pending.erase(client.pending.begin(), client.pending.begin() + written);
+    return true;
+  }
+
+  ModbusTcpGateway *gateway_;
+  uint16_t port_;
+  std::unique_ptr<esphome::socket::Socket> listener_;
+  std::vector<std::shared_ptr<Client>> clients_;
+  uint32_t forwarded_ = 0;
+};
+#endif
@@ -0,0 +1,153 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Verifica delle scritture con rilettura mirata
+// ============================================================================
+//
+// Dopo una scrittura FC16 l'unica conferma era il polling successivo (per i
+// programmi orari una rilettura di 476 registri). Qui ogni intervallo scritto
+// viene riletto da solo con una lettura USER dell'arbitro: dato che l'arbitro
+// non invia nulla finché le code dei controller non sono vuote, la rilettura
+// parte dopo la scrittura. Il risultato è confrontato con i valori inviati e
+// passato al chiamante, che aggiorna immagine raw ed entità (patch_register_image).
+// Più intervalli scritti insieme (es. il piano di ripristino del Block 2, che
+// può superare le MAX_QUEUED_PER_CLASS letture accodabili) si rileggono con una
+// sola lettura dal primo all'ultimo registro scritto.
+
+// Indirizzi dei registri riletti diversi da quelli scritti (vuoto se coincidono)
+inline std::vector<uint16_t> write_range_mismatches(const WriteRange &range, const std::vector<uint8_t> &data)
+{
+  std::vector<uint16_t> mismatches;
+  for (size_t i = 0; i < range.values.size(); i++)
+  {
+    if (data.size() < (i + 1) * 2)
+    {
+      mismatches.push_back(range.address + i);
+      continue;
+    }
+    uint16_t read = (data[i * 2] << 8) | data[i * 2 + 1];
+    if (read != range.values[i])
+      mismatches.push_back(range.address + i);
+  }
+  return mismatches;
+}
+
+// Copia i registri riletti (da start) nell'immagine raw di un blocco che parte da
+// image_start; false se l'immagine non è ancora stata letta o non contiene l'intervallo
+inline bool patch_register_image(std::vector<uint8_t> &image, size_t image_size, uint16_t image_start,
+                                 uint16_t start, const std::vector<uint8_t> &data)
+{
+  if (image.size() != image_size || start < image_start)
+    return false;
+  size_t offset = (start - image_start) * 2u;
+  if (offset + data.size() > image.size())
+    return false;
+  std::copy(data.begin(), data.end(), image.begin() + offset);
+  return true;
+}
+
+class WriteVerifier
+{
+public:
+  // match = true se i registri riletti coincidono con quelli scritti; data è
+  // vuoto se la rilettura non ha avuto risposta
+  typedef std::function<void(bool, uint16_t, const std::vector<uint8_t> &)> VerifyCallback;
+
+  // Accoda la rilettura dell'intervallo appena scritto; false se l'arbitro la rifiuta
+  bool verify(ModbusArbiter &arbiter, const WriteRange &range, VerifyCallback callback)
+  {
+    return verify(arbiter, std::vector<WriteRange>{range}, callback);
+  }
+
+  // Rilettura unica da min a max degli intervalli scritti (al massimo 125
+  // registri); i registri non scritti nel mezzo non vengono confrontati e la
+  // callback riceve tutta la lettura, da start
+  bool verify(ModbusArbiter &arbiter, const std::vector<WriteRange> &ranges, VerifyCallback callback)
+  {
+    if (ranges.empty())
+      return false;
+    uint16_t first = ranges[0].address;
+    uint32_t end = 0;
+    for (const WriteRange &range : ranges)
+    {
+      first = std::min(first, range.address);
+      end = std::max<uint32_t>(end, (uint32_t)range.address + range.values.size());
+    }
+    WriteVerifier *self = this;
+    uint16_t count = end - first;
+    bool queued = arbiter.submit_read(BusPriority::USER, first, count,
+                                      [self, ranges, first, count, callback](bool ok, uint16_t, const std::vector<uint8_t> &data)
+                                      { self->on_read_back(ranges, first, count, ok, data, callback); });
+    if (queued)
+      pending_++;
+    else
+      ESP_LOGW("write_verify", "Read-back of 0x%04X not queued", first);
+    return queued;
+  }
+
+  size_t pending() const { return pending_; }
+  uint32_t verified() const { return verified_; }
+  uint32_t mismatches() const { return mismatches_; }
+  uint32_t failures() const { return failures_; }
+  // Ultimo intervallo non confermato, es. "0x0408+32: 0x040A 0x0411" (vuoto se nessuno)
+  const std::string &last_mismatch() const { return last_mismatch_; }
+
+private:
+  void on_read_back(const std::vector<WriteRange> &ranges, uint16_t first, uint16_t count, bool ok,
+                    const std::vector<uint8_t> &data, const VerifyCallback &callback)
+  {
+    pending_--;
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "0x%04X+%d:", first, (int)count);
+    if (!ok)
+    {
+      failures_++;
+      last_mismatch_ = std::string(buffer) + " no response";
+      ESP_LOGW("write_verify", "Read-back of %s no response", buffer);
+      if (callback)
+        callback(false, first, std::vector<uint8_t>());
+      return;
+    }
+
+    std::vector<uint16_t> different;
+    for (const WriteRange &range : ranges)
+    {
+      size_t offset = (range.address - first) * 2u;
+      std::vector<uint8_t> slice(data.begin() + std::min(offset, data.size()), data.end());
+      std::vector<uint16_t> range_different = write_range_mismatches(range, slice);
+      different.insert(different.end(), range_different.begin(), range_different.end());
+    }
+    std::sort(different.begin(), different.end());
+    if (different.empty())
+    {
+      verified_++;
+      ESP_LOGD("write_verify", "%s verified", buffer);
+    }
+    else
+    {
+      mismatches_++;
+      last_mismatch_ = buffer;
+      for (size_t i = 0; i < different.size() && i < 8; i++)
+      {
+        char address[8];
+        snprintf(address, sizeof(address), " 0x%04X", different[i]);
+        last_mismatch_ += address;
+      }
+      ESP_LOGE("write_verify", "%s %d registers differ after the write", buffer, (int)different.size());
+    }
+    if (callback)
+      callback(different.empty(), first, data);
+  }
+
+  size_t pending_ = 0;
+  uint32_t verified_ = 0;
+  uint32_t mismatches_ = 0;
+  uint32_t failures_ = 0;
+  std::string last_mismatch_;
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#ifdef USE_ESP32
+#include "esphome/core/hal.h"
+#endif
+
+// ============================================================================
+// Pubblicazione delle entità a fette di tempo
+// ============================================================================
+//
+// Le lambda dei Block 1 e 2 decodificano decine di entità per risposta: invece
+// di chiamare publish_state() in sequenza (e bloccare il loop, quindi Ethernet
+// e API, per tutta la durata) accodano qui i valori. drain() viene chiamata a
+// ogni iterazione del loop (esphome: on_loop) e pubblica finché non esaurisce
+// il budget in µs, prima gli allarmi, poi le misure, poi i parametri.
+//
+// Un'entità ancora in coda viene aggiornata sul posto: conta solo l'ultimo
+// valore e la posizione resta quella del primo accodamento. Ogni drain()
+// pubblica almeno un valore, così la coda avanza anche con budget minimi.
+//
+// Ogni entità ha uno slot fisso (valore, funzione di pubblicazione, flag "in
+// coda") creato al primo accodamento e riusato a ogni round: a regime
+// publish() e drain() non allocano memoria (a parte il testo dei text sensor
+// più lungo del precedente).
+
+enum PublishPriority : uint8_t
+{
+  PUBLISH_ALARM = 0, // Bit di allarme e guasto (0x110)
+  PUBLISH_MEASURE,   // Temperature, velocità, stati
+  PUBLISH_PARAMETER, // Parametri macchina (Block 2)
+  PUBLISH_PRIORITIES
+};
+
+// Slot di un'entità: il valore è in number, flag o text secondo il tipo
+struct PublishSlot
+{
+  void *entity;
+  void (*apply)(PublishSlot &); // entity->publish_state(valore) col tipo giusto
+  float number;
+  bool flag;
+  std::string text;
+  bool queued;
+};
+
+class PublishScheduler
+{
+public:
+  explicit PublishScheduler(uint32_t budget_us = 2000) : budget_us_(budget_us) {}
+
+  // Accoda entity->publish_state(value) (sensor, binary_sensor, text_sensor, ...)
+  template <typename Entity, typename Value>
+  void publish(Entity *entity, Value value, PublishPriority priority)
+  {
+    size_t index = slot_index(entity);
+    store<Entity>(slots_[index], value,
+                  ValueKind<std::is_same<Value, bool>::value ? 0 : std::is_arithmetic<Value>::value ? 1 : 2>());
+    enqueue(index, priority);
+  }
+
+  // Pubblica in ordine di priorità finché now_us() - inizio < budget; ritorna
+  // il numero di valori pubblicati
+  size_t drain(const std::function<uint32_t()> &now_us)
+  {
+    if (queued_ == 0)
+      return 0;
+    uint32_t started = now_us();
+    size_t published = 0;
+    for (size_t priority = 0; priority < PUBLISH_PRIORITIES; priority++)
+    {
+      std::vector<size_t> &queue = queues_[priority];
+      // Indici, non iteratori: una pubblicazione può accodare altri valori
+      while (heads_[priority] < queue.size())
+      {
+        if (published > 0 && now_us() - started >= budget_us_)
+          return published;
+        PublishSlot &slot = slots_[queue[heads_[priority]++]];
+        slot.queued = false;
+        queued_--;
+        slot.apply(slot);
+        published++;
+      }
+      queue.clear(); // La capacità resta per il round successivo
+      heads_[priority] = 0;
+    }
+    return published;
+  }
+
+#ifdef USE_ESP32
+  size_t drain()
+  {
+    return drain([]() { return (uint32_t)esphome::micros(); });
+  }
+#endif
+
+  size_t queued() const { return queued_; }
+  // Valori sostituiti da uno più recente prima della pubblicazione
+  uint32_t merged() const { return merged_; }
+  // Massimo numero di entità in coda contemporaneamente
+  size_t max_queued() const { return max_queued_; }
+  // Entità con uno slot (ciascuna accodata almeno una volta)
+  size_t entities() const { return slots_.size(); }
+
+private:
+  template <int KIND>
+  struct ValueKind
+  {
+  };
+
+  template <typename Entity>
+  static void apply_flag(PublishSlot &slot) { static_cast<Entity *>(slot.entity)->publish_state(slot.flag); }
+  template <typename Entity>
+  static void apply_number(PublishSlot &slot) { static_cast<Entity *>(slot.entity)->publish_state(slot.number); }
+  template <typename Entity>
+  static void apply_text(PublishSlot &slot) { static_cast<Entity *>(slot.entity)->publish_state(slot.text); }
+
+  template <typename Entity, typename Value>
+  static void store(PublishSlot &slot, Value value, ValueKind<0>)
+  {
+    slot.flag = value;
+    slot.apply = &apply_flag<Entity>;
+  }
+  template <typename Entity, typename Value>
+  static void store(PublishSlot &slot, Value value, ValueKind<1>)
+  {
+    slot.number = value;
+    slot.apply = &apply_number<Entity>;
+  }
+  template <typename Entity, typename Value>
+  static void store(PublishSlot &slot, const Value &value, ValueKind<2>)
+  {
+    slot.text = value;
+    slot.apply = &apply_text<Entity>;
+  }
+
+  size_t slot_index(void *entity)
+  {
+    auto index = indexes_.find(entity);
+    if (index != indexes_.end())
+      return index->second;
+    indexes_[entity] = slots_.size();
+    slots_.push_back(PublishSlot{entity, nullptr, 0.0f, false, std::string(), false});
+    return slots_.size() - 1;
+  }
+
+  void enqueue(size_t index, PublishPriority priority)
+  {
+    PublishSlot &slot = slots_[index];
+    if (slot.queued)
+    {
+      merged_++;
+      return;
+    }
+    slot.queued = true;
+    queues_[priority].push_back(index);
+    queued_++;
+    if (queued_ > max_queued_)
+      max_queued_ = queued_;
+  }
+
+  uint32_t budget_us_;
+  std::deque<PublishSlot> slots_; // deque: riferimenti stabili quando si aggiungono entità
+  std::unordered_map<const void *, size_t> indexes_;
+  std::vector<size_t> queues_[PUBLISH_PRIORITIES]; // Indici degli slot in attesa
+  size_t heads_[PUBLISH_PRIORITIES] = {};
+  size_t queued_ = 0;
+  uint32_t merged_ = 0;
+  size_t max_queued_ = 0;
+};
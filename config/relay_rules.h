@@ -0,0 +1,264 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+// ============================================================================
+// Regole locali dei relè sullo stato decodificato della VMC
+// ============================================================================
+//
+// Ogni regola lega un relè a un insieme di condizioni (in AND) sui registri
+// dei Block 1-3: soglie con isteresi (costanti o lette da un altro registro,
+// es. T4 contro 0x0232), bit di allarme e campi di stato. I lambda dei blocchi
+// passano le immagini raw a on_registers(): una regola viene valutata solo se
+// è cambiato uno dei suoi registri, quindi a ingressi stabili non costa nulla.
+//
+// Tempi minimi di acceso/spento: se una regola vuole commutare prima del
+// tempo la commutazione resta in attesa e tick() la applica alla scadenza
+// (tick() non fa nulla se non ci sono commutazioni in attesa). Alla prima
+// valutazione il relè viene portato subito allo stato richiesto.
+//
+// Link perso: on_link_lost() dimentica i registri e porta subito ogni relè nel
+// proprio stato sicuro, senza attendere i tempi minimi e senza Home Assistant.
+
+enum class RuleOp : uint8_t
+{
+  BELOW,       // (int16) registro < soglia
+  ABOVE,       // (int16) registro > soglia
+  BITS_ANY,    // almeno un bit di mask a 1
+  BITS_NONE,   // tutti i bit di mask a 0
+  FIELD_EQUALS // (registro & mask) == value
+};
+
+static const uint16_t RULE_CONSTANT = 0xFFFF; // Soglia costante, non da registro
+
+struct RuleCondition
+{
+  RuleOp op;
+  uint16_t address;
+  int16_t value;              // Soglia costante o valore del campo
+  uint16_t mask;              // Bit per BITS_ANY / BITS_NONE / FIELD_EQUALS
+  uint16_t threshold_address; // Registro con la soglia, o RULE_CONSTANT
+  int16_t hysteresis;         // In unità del registro, verso il rientro
+
+  static RuleCondition below(uint16_t address, int16_t threshold, int16_t hysteresis)
+  {
+    return {RuleOp::BELOW, address, threshold, 0, RULE_CONSTANT, hysteresis};
+  }
+  static RuleCondition below_register(uint16_t address, uint16_t threshold_address, int16_t hysteresis)
+  {
+    return {RuleOp::BELOW, address, 0, 0, threshold_address, hysteresis};
+  }
+  static RuleCondition above(uint16_t address, int16_t threshold, int16_t hysteresis)
+  {
+    return {RuleOp::ABOVE, address, threshold, 0, RULE_CONSTANT, hysteresis};
+  }
+  static RuleCondition above_register(uint16_t address, uint16_t threshold_address, int16_t hysteresis)
+  {
+    return {RuleOp::ABOVE, address, 0, 0, threshold_address, hysteresis};
+  }
+  static RuleCondition bits_any(uint16_t address, uint16_t mask)
+  {
+    return {RuleOp::BITS_ANY, address, 0, mask, RULE_CONSTANT, 0};
+  }
+  static RuleCondition bits_none(uint16_t address, uint16_t mask)
+  {
+    return {RuleOp::BITS_NONE, address, 0, mask, RULE_CONSTANT, 0};
+  }
+  static RuleCondition field_equals(uint16_t address, uint16_t mask, uint16_t value)
+  {
+    return {RuleOp::FIELD_EQUALS, address, (int16_t)value, mask, RULE_CONSTANT, 0};
+  }
+};
+
+struct RelayRule
+{
+  uint8_t relay; // 1-8 (relais.yaml)
+  std::vector<RuleCondition> conditions;
+  uint32_t min_on_ms;
+  uint32_t min_off_ms;
+  bool safe_state; // Stato senza dati validi dalla VMC
+};
+
+class RelayRuleEngine
+{
+public:
+  typedef std::function<void(uint8_t relay, bool on)> RelayWriter;
+
+  void set_rules(const std::vector<RelayRule> &rules, RelayWriter writer)
+  {
+    rules_ = rules;
+    writer_ = writer;
+    states_.assign(rules_.size(), RuleState());
+    values_.clear();
+    dependents_.clear();
+    for (size_t r = 0; r < rules_.size(); r++)
+    {
+      for (const RuleCondition &condition : rules_[r].conditions)
+      {
+        dependents_[condition.address].push_back(r);
+        if (condition.threshold_address != RULE_CONSTANT)
+          dependents_[condition.threshold_address].push_back(r);
+      }
+    }
+  }
+
+  // Immagine raw di un blocco letto da start: valuta le regole con ingressi cambiati
+  void on_registers(uint16_t start, const std::vector<uint8_t> &data, uint32_t now_ms)
+  {
+    uint32_t end = start + data.size() / 2;
+    std::vector<bool> dirty(rules_.size(), false);
+    bool any = false;
+    for (auto it = dependents_.lower_bound(start); it != dependents_.end() && it->first < end; ++it)
+    {
+      size_t offset = (it->first - start) * 2u;
+      uint16_t value = (data[offset] << 8) | data[offset + 1];
+      auto known = values_.find(it->first);
+      if (known != values_.end() && known->second == value)
+        continue;
+      values_[it->first] = value;
+      for (size_t r : it->second)
+        dirty[r] = true;
+      any = true;
+    }
+    if (!any)
+      return;
+    for (size_t r = 0; r < rules_.size(); r++)
+      if (dirty[r])
+        evaluate(r, now_ms);
+  }
+
+  // Applica le commutazioni rimandate dai tempi minimi
+  void tick(uint32_t now_ms)
+  {
+    if (deferred_ == 0)
+      return;
+    for (size_t r = 0; r < rules_.size(); r++)
+      if (states_[r].deferred)
+        evaluate(r, now_ms);
+  }
+
+  void on_link_lost(uint32_t now_ms)
+  {
+    values_.clear();
+    for (size_t r = 0; r < rules_.size(); r++)
+    {
+      set_deferred(r, false);
+      if (states_[r].output != (rules_[r].safe_state ? 1 : 0))
+        apply(r, rules_[r].safe_state, now_ms);
+    }
+  }
+
+  // Stato del relè della regola: -1 se non ancora valutata
+  int output(size_t rule) const { return states_[rule].output; }
+  bool deferred(size_t rule) const { return states_[rule].deferred; }
+  uint32_t evaluations() const { return evaluations_; }
+  uint32_t switches() const { return switches_; }
+
+private:
+  struct RuleState
+  {
+    int8_t output = -1;
+    bool deferred = false;
+    uint32_t last_switch_ms = 0;
+  };
+
+  bool read(uint16_t address, uint16_t &value) const
+  {
+    auto it = values_.find(address);
+    if (it == values_.end())
+      return false;
+    value = it->second;
+    return true;
+  }
+
+  // -1 se un registro non è ancora noto
+  int holds(const RuleCondition &condition, bool on) const
+  {
+    uint16_t raw;
+    if (!read(condition.address, raw))
+      return -1;
+    int32_t threshold = condition.value;
+    if (condition.threshold_address != RULE_CONSTANT)
+    {
+      uint16_t threshold_raw;
+      if (!read(condition.threshold_address, threshold_raw))
+        return -1;
+      threshold = (int16_t)threshold_raw;
+    }
+    switch (condition.op)
+    {
+    case RuleOp::BELOW:
+      // Acceso resta fino a soglia + isteresi
+      return (int16_t)raw < threshold + (on ? condition.hysteresis : 0);
+    case RuleOp::ABOVE:
+      return (int16_t)raw > threshold - (on ? condition.hysteresis : 0);
+    case RuleOp::BITS_ANY:
+      return (raw & condition.mask) != 0;
+    case RuleOp::BITS_NONE:
+      return (raw & condition.mask) == 0;
+    case RuleOp::FIELD_EQUALS:
+      return (raw & condition.mask) == (uint16_t)condition.value;
+    }
+    return -1;
+  }
+
+  void evaluate(size_t r, uint32_t now_ms)
+  {
+    evaluations_++;
+    const RelayRule &rule = rules_[r];
+    RuleState &state = states_[r];
+    bool desired = true;
+    for (const RuleCondition &condition : rule.conditions)
+    {
+      int result = holds(condition, state.output == 1);
+      if (result < 0)
+        return; // Ingressi incompleti: nessuna decisione
+      desired = desired && result == 1;
+    }
+
+    if (state.output == (desired ? 1 : 0))
+    {
+      set_deferred(r, false);
+      return;
+    }
+    uint32_t min_ms = state.output == 1 ? rule.min_on_ms : rule.min_off_ms;
+    if (state.output >= 0 && now_ms - state.last_switch_ms < min_ms)
+    {
+      set_deferred(r, true);
+      return;
+    }
+    set_deferred(r, false);
+    apply(r, desired, now_ms);
+  }
+
+  void apply(size_t r, bool on, uint32_t now_ms)
+  {
+    states_[r].output = on ? 1 : 0;
+    states_[r].last_switch_ms = now_ms;
+    switches_++;
+    if (writer_)
+      writer_(rules_[r].relay, on);
+  }
+
+  void set_deferred(size_t r, bool deferred)
+  {
+    if (states_[r].deferred == deferred)
+      return;
+    states_[r].deferred = deferred;
+    if (deferred)
+      deferred_++;
+    else
+      deferred_--;
+  }
+
+  std::vector<RelayRule> rules_;
+  RelayWriter writer_;
+  std::vector<RuleState> states_;
+  std::map<uint16_t, uint16_t> values_;                // Ultimo valore dei registri usati
+  std::map<uint16_t, std::vector<size_t>> dependents_; // Registro -> regole che lo usano
+  size_t deferred_ = 0;
+  uint32_t evaluations_ = 0;
+  uint32_t switches_ = 0;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Richiede Blk2_MachineParameters.h (blk2_restore_plan)
+
+// ============================================================================
+// Soglie di free cooling / free heating per stagione (0x021B / 0x021C)
+// ============================================================================
+//
+// La temperatura esterna T1 (0x0100, decimi di °C) arriva a ogni round di
+// polling: i campioni si sommano in un intervallo di bucket_ms, la cui media
+// entra in un anello di al massimo `buckets` medie. La stagione si decide
+// sulla media mobile dell'anello (somma corrente, nessun ricalcolo) appena ci
+// sono almeno min_buckets medie:
+//   - estate se la media supera summer_above;
+//   - si torna all'inverno solo sotto summer_above - hysteresis.
+// Una giornata calda in inverno o un pomeriggio fresco d'estate non fanno
+// oscillare le soglie.
+//
+// Le soglie vengono scritte solo al cambio di stagione (la prima decisione
+// dopo l'avvio conta come cambio) e solo per i registri che differiscono
+// dall'immagine del Block 2: se l'immagine non è ancora stata letta la
+// scrittura resta in attesa del round successivo.
+
+enum class Season : uint8_t
+{
+  UNKNOWN,
+  WINTER,
+  SUMMER
+};
+
+// Soglie in decimi di °C
+struct SeasonProfile
+{
+  int16_t free_cooling; // 0x021B
+  int16_t free_heating; // 0x021C
+};
+
+static const uint16_t SEASON_FREE_COOLING_REGISTER = 0x021B;
+static const uint16_t SEASON_FREE_HEATING_REGISTER = 0x021C;
+
+class SeasonalController
+{
+public:
+  SeasonalController(int16_t summer_above = 250, int16_t hysteresis = 30, uint32_t bucket_ms = 600000,
+                     uint8_t buckets = 18, uint8_t min_buckets = 3, SeasonProfile summer = {220, 180},
+                     SeasonProfile winter = {260, 150})
+      : summer_above_(summer_above), hysteresis_(hysteresis), bucket_ms_(bucket_ms),
+        buckets_(buckets == 0 ? 1 : buckets), min_buckets_(min_buckets == 0 ? 1 : min_buckets), summer_(summer),
+        winter_(winter), averages_(buckets_, 0) {}
+
+  // Campione di T1 in decimi; true se la stagione è cambiata
+  bool on_t1(int16_t tenths, uint32_t now_ms)
+  {
+    if (bucket_count_ == 0)
+      bucket_start_ms_ = now_ms;
+    bucket_sum_ += tenths;
+    bucket_count_++;
+    if (now_ms - bucket_start_ms_ < bucket_ms_)
+      return false;
+
+    // Chiude il bucket: la media (arrotondata) sostituisce la più vecchia
+    int32_t half = bucket_count_ / 2;
+    int16_t mean = (int16_t)((bucket_sum_ + (bucket_sum_ >= 0 ? half : -half)) / (int32_t)bucket_count_);
+    bucket_sum_ = 0;
+    bucket_count_ = 0;
+    if (filled_ == buckets_)
+      sum_ -= averages_[next_];
+    else
+      filled_++;
+    averages_[next_] = mean;
+    sum_ += mean;
+    next_ = (next_ + 1) % buckets_;
+    if (filled_ < min_buckets_)
+      return false;
+
+    Season season = season_;
+    int16_t avg = average();
+    if (season_ == Season::UNKNOWN)
+      season = avg > summer_above_ ? Season::SUMMER : Season::WINTER;
+    else if (season_ == Season::WINTER && avg > summer_above_)
+      season = Season::SUMMER;
+    else if (season_ == Season::SUMMER && avg < summer_above_ - hysteresis_)
+      season = Season::WINTER;
+    if (season == season_)
+      return false;
+    season_ = season;
+    transitions_++;
+    write_pending_ = true;
+    return true;
+  }
+
+  // Scritture per portare le soglie al profilo della stagione: solo i
+  // registri diversi dall'immagine del Block 2, vuoto se coincidono già.
+  // false (e scrittura ancora in attesa) se l'immagine non è valida
+  bool take_write_plan(const std::vector<uint8_t> &image, std::vector<WriteRange> &plan)
+  {
+    plan.clear();
+    if (!write_pending_ || image.size() != BLK2_IMAGE_SIZE)
+      return false;
+    const SeasonProfile &target_profile = profile();
+    std::vector<uint8_t> target = image;
+    set_register(target, SEASON_FREE_COOLING_REGISTER, target_profile.free_cooling);
+    set_register(target, SEASON_FREE_HEATING_REGISTER, target_profile.free_heating);
+    plan = blk2_restore_plan(image, target, (1ULL << (SEASON_FREE_COOLING_REGISTER - BLK2_ADDRESS)) |
+                                                (1ULL << (SEASON_FREE_HEATING_REGISTER - BLK2_ADDRESS)));
+    write_pending_ = false;
+    return true;
+  }
+
+  Season season() const { return season_; }
+  const char *season_name() const
+  {
+    return season_ == Season::SUMMER ? "Summer" : season_ == Season::WINTER ? "Winter" : "Unknown";
+  }
+  const SeasonProfile &profile() const { return season_ == Season::SUMMER ? summer_ : winter_; }
+  bool has_average() const { return filled_ >= min_buckets_; }
+  // Media mobile in decimi di °C (0 finché non ci sono medie)
+  int16_t average() const { return filled_ == 0 ? 0 : (int16_t)(sum_ / (int32_t)filled_); }
+  bool write_pending() const { return write_pending_; }
+  uint32_t transitions() const { return transitions_; }
+
+private:
+  static void set_register(std::vector<uint8_t> &image, uint16_t address, int16_t value)
+  {
+    size_t offset = (address - BLK2_ADDRESS) * 2u;
+    image[offset] = (uint16_t)value >> 8;
+    image[offset + 1] = (uint16_t)value & 0xFF;
+  }
+
+  int16_t summer_above_;
+  int16_t hysteresis_;
+  uint32_t bucket_ms_;
+  uint8_t buckets_;
+  uint8_t min_buckets_;
+  SeasonProfile summer_;
+  SeasonProfile winter_;
+  std::vector<int16_t> averages_; // Anello delle medie dei bucket
+  size_t next_ = 0;
+  uint8_t filled_ = 0;
+  int32_t sum_ = 0;
+  int32_t bucket_sum_ = 0;
+  uint32_t bucket_count_ = 0;
+  uint32_t bucket_start_ms_ = 0;
+  Season season_ = Season::UNKNOWN;
+  bool write_pending_ = false;
+  uint32_t transitions_ = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// ============================================================================
+// Capacità hardware della VMC (Block 0 + registro 0x11F del Block 1)
+// ============================================================================
+//
+// Le sonde opzionali (CO2, pressione differenziale, RH) sono dichiarate dai bit
+// 12-14 del registro 0x11F. Finché i blocchi non sono stati letti tutte le
+// capacità sono considerate presenti, così al primo giro non si perde nulla;
+// dopo la prima lettura le entità delle sonde assenti non vengono più
+// decodificate né pubblicate.
+
+enum VmcCapability : uint8_t
+{
+  CAP_CO2_SENSOR = 1 << 0,           // 0x11F bit 12 -> CO2 reading (0x113)
+  CAP_DIFF_PRESSURE_SENSOR = 1 << 1, // 0x11F bit 13 -> Diff pressure 1/2 (0x111, 0x112)
+  CAP_RH_SENSOR = 1 << 2,            // 0x11F bit 14 -> RH reading (0x114)
+};
+
+static const uint8_t CAP_ALL_SENSORS = CAP_CO2_SENSOR | CAP_DIFF_PRESSURE_SENSOR | CAP_RH_SENSOR;
+
+// Nome del modello dal registro 0x000A del Block 0; stringa vuota se sconosciuto
+inline std::string vmc_model_name(uint16_t model_code)
+{
+  switch (model_code)
+  {
+  case 0x5200: return "ESP170V";
+  case 0x5201: return "ESP270";
+  case 0x5202: return "ESP360";
+  case 0x5203: return "ESP460";
+  case 0x5204: return "ESP170H";
+  case 0x5205: return "ESP180";
+  case 0x5206: return "ESP280";
+  case 0x5207: return "ESP370";
+  case 0x5208: return "ESP600";
+  case 0x5300: return "ENYP1";
+  case 0x5301: return "ENYP2";
+  case 0x5302: return "ENYP3";
+  case 0x5303: return "ENYP4";
+  default: return "";
+  }
+}
+
+// Capacità dichiarate dal registro 0x11F (Options/Info)
+inline uint8_t capabilities_from_options(uint16_t options)
+{
+  uint8_t caps = 0;
+  if (options & (1 << 12))
+    caps |= CAP_CO2_SENSOR;
+  if (options & (1 << 13))
+    caps |= CAP_DIFF_PRESSURE_SENSOR;
+  if (options & (1 << 14))
+    caps |= CAP_RH_SENSOR;
+  return caps;
+}
+
+class VmcCapabilities
+{
+public:
+  // Block 0: modello del controller
+  void on_model(uint16_t model_code)
+  {
+    model_code_ = model_code;
+    model_known_ = !vmc_model_name(model_code).empty();
+  }
+
+  // Block 1: registro 0x11F. Ritorna le capacità appena sparite (da marcare non disponibili)
+  uint8_t on_options(uint16_t options)
+  {
+    uint8_t previous = resolved_ ? caps_ : CAP_ALL_SENSORS;
+    caps_ = capabilities_from_options(options);
+    resolved_ = true;
+    if (caps_ != previous)
+      ESP_LOGI("vmc_caps", "Sensors present: CO2=%d DP=%d RH=%d", has(CAP_CO2_SENSOR),
+               has(CAP_DIFF_PRESSURE_SENSOR), has(CAP_RH_SENSOR));
+    return previous & ~caps_;
+  }
+
+  // True se l'entità va decodificata e pubblicata (sempre, finché non risolto)
+  bool has(uint8_t capability) const { return !resolved_ || (caps_ & capability) == capability; }
+
+  bool resolved() const { return resolved_; }
+  bool model_known() const { return model_known_; }
+  uint16_t model_code() const { return model_code_; }
+  uint8_t capabilities() const { return resolved_ ? caps_ : CAP_ALL_SENSORS; }
+
+private:
+  bool resolved_ = false;
+  uint8_t caps_ = 0;
+  uint16_t model_code_ = 0;
+  bool model_known_ = false;
+};
@@ -0,0 +1,185 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// ============================================================================
+// Percorso veloce ingresso digitale -> comando VMC
+// ============================================================================
+//
+// I comandi partono dal controller dedicato sabiana_vmc_fast, la cui coda è
+// normalmente vuota: sul bus passano subito dopo il frame in corso, senza
+// attendere le letture dei blocchi accodate su sabiana_vmc. Dopo la scrittura
+// viene letto solo 0x0307-0x0309 per confermare lo stato, senza aspettare il
+// prossimo polling del Block 3.
+
+static const uint16_t FAST_PATH_MODE_ADDRESS = 0x0307;
+static const uint16_t FAST_PATH_MANUAL_SPEED_ADDRESS = 0x0309;
+static const uint16_t FAST_PATH_READBACK_COUNT = 3; // 0x0307, 0x0308 (parameter reset), 0x0309
+
+// Valori del registro 0x0307
+static const uint16_t VMC_MODE_HOLIDAY = 0;
+static const uint16_t VMC_MODE_AUTO = 1;
+static const uint16_t VMC_MODE_PROGRAM = 2;
+static const uint16_t VMC_MODE_MANUAL = 3;
+static const uint16_t VMC_MODE_PARTY = 4;
+
+enum class FastAction : uint8_t
+{
+  MODE,         // Scrive la modalità (0x0307 = value)
+  PARTY,        // Boost: modalità Party (0x0307 = 4)
+  MANUAL_SPEED  // Modalità Manual + velocità (0x0307 = 3, 0x0309 = value)
+};
+
+struct FastWrite
+{
+  uint16_t address;
+  uint16_t value;
+};
+
+// Scritture necessarie per un'azione; vuoto se il valore non è valido
+inline std::vector<FastWrite> fast_writes_for(FastAction action, uint16_t value)
+{
+  std::vector<FastWrite> writes;
+  switch (action)
+  {
+  case FastAction::MODE:
+    if (value <= VMC_MODE_PARTY)
+      writes.push_back({FAST_PATH_MODE_ADDRESS, value});
+    break;
+  case FastAction::PARTY:
+    writes.push_back({FAST_PATH_MODE_ADDRESS, VMC_MODE_PARTY});
+    break;
+  case FastAction::MANUAL_SPEED:
+    // 0x0308 (parameter reset) sta in mezzo: due scritture singole, non un FC16
+    if (value <= 3)
+    {
+      writes.push_back({FAST_PATH_MODE_ADDRESS, VMC_MODE_MANUAL});
+      writes.push_back({FAST_PATH_MANUAL_SPEED_ADDRESS, value});
+    }
+    break;
+  }
+  return writes;
+}
+
+// Esegue le azioni degli ingressi e ne conferma l'esito con una lettura mirata.
+// lockout_ms scarta i comandi ripetuti a raffica (es. rimbalzi oltre il filtro
+// delayed_on_off o più ingressi collegati allo stesso comando).
+class VmcFastPath
+{
+public:
+  // ok, modalità letta, velocità manuale letta
+  typedef std::function<void(bool, uint16_t, uint16_t)> ConfirmCallback;
+
+  explicit VmcFastPath(uint32_t lockout_ms = 300, uint8_t max_retries = 1)
+      : lockout_ms_(lockout_ms), max_retries_(max_retries) {}
+
+  bool trigger(modbus_controller::ModbusController *controller, FastAction action, uint16_t value,
+               uint32_t now_ms, ConfirmCallback on_confirm = nullptr)
+  {
+    std::vector<FastWrite> writes = fast_writes_for(action, value);
+    if (writes.empty())
+    {
+      ESP_LOGW("fast_path", "Invalid fast path value %d", value);
+      return false;
+    }
+
+    if (writes_equal(writes, last_) && (uint32_t)(now_ms - triggered_ms_) < lockout_ms_)
+    {
+      ESP_LOGD("fast_path", "Duplicate command inside lockout, ignored");
+      return false;
+    }
+
+    pending_ = writes;
+    last_ = writes;
+    has_pending_ = true;
+    triggered_ms_ = now_ms;
+    retries_ = 0;
+    on_confirm_ = on_confirm;
+    send(controller);
+    return true;
+  }
+
+  // Confronta la lettura di 0x0307-0x0309 con quanto scritto; ritorna true se coincide
+  bool on_readback(modbus_controller::ModbusController *controller, const std::vector<uint8_t> &data, uint32_t now_ms)
+  {
+    if (!has_pending_ || data.size() != FAST_PATH_READBACK_COUNT * 2)
+      return false;
+
+    uint16_t mode = (data[0] << 8) | data[1];
+    uint16_t speed = (data[4] << 8) | data[5];
+
+    bool ok = true;
+    for (size_t i = 0; i < pending_.size(); i++)
+    {
+      uint16_t actual = pending_[i].address == FAST_PATH_MODE_ADDRESS ? mode : speed;
+      if (actual != pending_[i].value)
+        ok = false;
+    }
+
+    if (!ok && retries_ < max_retries_)
+    {
+      retries_++;
+      ESP_LOGW("fast_path", "Readback mismatch (mode=%d speed=%d), retry %d", mode, speed, retries_);
+      send(controller);
+      return false;
+    }
+
+    last_latency_ms_ = now_ms - triggered_ms_;
+    has_pending_ = false;
+    confirmed_ = ok;
+    if (ok)
+      ESP_LOGI("fast_path", "Command confirmed in %u ms", last_latency_ms_);
+    else
+      ESP_LOGE("fast_path", "Command not applied by the VMC (mode=%d speed=%d)", mode, speed);
+
+    if (on_confirm_)
+      on_confirm_(ok, mode, speed);
+    return ok;
+  }
+
+  bool pending() const { return has_pending_; }
+  bool confirmed() const { return confirmed_; }
+  uint32_t last_latency_ms() const { return last_latency_ms_; }
+
+private:
+  static bool writes_equal(const std::vector<FastWrite> &a, const std::vector<FastWrite> &b)
+  {
+    if (a.size() != b.size())
+      return false;
+    for (size_t i = 0; i < a.size(); i++)
+      if (a[i].address != b[i].address || a[i].value != b[i].value)
+        return false;
+    return true;
+  }
+
+  void send(modbus_controller::ModbusController *controller)
+  {
+    for (size_t i = 0; i < pending_.size(); i++)
+    {
+      auto cmd = modbus_controller::ModbusCommandItem::create_write_single_command(
+          controller, pending_[i].address, pending_[i].value);
+      controller->queue_command(cmd);
+    }
+
+    VmcFastPath *self = this;
+    auto readback = modbus_controller::ModbusCommandItem::create_read_command(
+        controller, modbus_controller::ModbusRegisterType::HOLDING, FAST_PATH_MODE_ADDRESS, FAST_PATH_READBACK_COUNT,
+        [self, controller](modbus_controller::ModbusRegisterType, uint16_t, const std::vector<uint8_t> &data)
+        { self->on_readback(controller, data, millis()); });
+    controller->queue_command(readback);
+  }
+
+  uint32_t lockout_ms_;
+  uint8_t max_retries_;
+
+  std::vector<FastWrite> pending_;
+  std::vector<FastWrite> last_;
+  bool has_pending_ = false;
+  uint32_t triggered_ms_ = 0;
+  uint8_t retries_ = 0;
+  ConfirmCallback on_confirm_;
+
+  bool confirmed_ = false;
+  uint32_t last_latency_ms_ = 0;
+};
@@ -0,0 +1,278 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Endpoint HTTP con lo stato completo della VMC (GET /vmc/state)
+// ============================================================================
+//
+// Il documento JSON viene generato al più una volta per round di polling (o
+// quando cambiano i programmi orari) e servito dalla cache: le richieste non
+// generano mai traffico Modbus. L'ETag contiene la sequenza del round e
+// un'impronta dei programmi, così un client con If-None-Match riceve 304.
+//
+// Il rendering avviene nel loop principale su una bozza separata, che poi
+// sostituisce il documento sotto mutex: il server web gira in un altro task e
+// copia corpo ed ETag con snapshot(), mai a metà di un rendering.
+
+static const char *const VMC_HTTP_STATE_PATH = "/vmc/state";
+
+class VmcStateDocument
+{
+public:
+  VmcStateDocument() {}
+  VmcStateDocument(const VmcStateDocument &other) { copy_from(other); }
+  VmcStateDocument &operator=(const VmcStateDocument &other)
+  {
+    if (this != &other)
+      copy_from(other);
+    return *this;
+  }
+
+  // Rigenera il documento se round o programmi sono cambiati; ritorna true se rigenerato
+  bool refresh(const VmcSnapshot &snapshot, const std::vector<std::vector<uint8_t>> &programs)
+  {
+    uint32_t programs_hash = hash_programs(programs);
+    if (ready_ && snapshot.sequence == sequence_ && programs_hash == programs_hash_)
+      return false;
+    if (snapshot.sequence == 0)
+      return false; // Nessun round ancora completato
+
+    sequence_ = snapshot.sequence;
+    programs_hash_ = programs_hash;
+    render(snapshot, programs);
+
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%x-%08x\"", (unsigned)sequence_, (unsigned)programs_hash_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      body_.swap(draft_);
+      etag_ = etag;
+      ready_ = true;
+    }
+    renders_++;
+    return true;
+  }
+
+  // If-None-Match della richiesta (anche lista di ETag separati da virgola)
+  bool not_modified(const std::string &if_none_match) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ready_ && matches(etag_, if_none_match);
+  }
+
+  // Per il task del web server: ETag e, se il client non ha già questa
+  // versione, corpo copiati insieme. false se nessun documento è pronto
+  bool snapshot(const std::string &if_none_match, std::string &etag, std::string &body, bool &not_modified) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ready_)
+      return false;
+    etag = etag_;
+    not_modified = matches(etag_, if_none_match);
+    if (!not_modified)
+      body = body_;
+    return true;
+  }
+
+  // Accesso diretto solo dal loop principale, che è l'unico a rigenerare
+  bool ready() const { return ready_; }
+  const std::string &body() const { return body_; }
+  const std::string &etag() const { return etag_; }
+  uint32_t renders() const { return renders_; }
+
+private:
+  static bool matches(const std::string &etag, const std::string &if_none_match)
+  {
+    if (if_none_match.empty())
+      return false;
+    return if_none_match == "*" || if_none_match.find(etag) != std::string::npos;
+  }
+
+  void copy_from(const VmcStateDocument &other)
+  {
+    std::lock_guard<std::mutex> lock(other.mutex_);
+    ready_ = other.ready_;
+    sequence_ = other.sequence_;
+    programs_hash_ = other.programs_hash_;
+    renders_ = other.renders_;
+    body_ = other.body_;
+    etag_ = other.etag_;
+  }
+
+  // FNV-1a a 32 bit sulle immagini dei programmi
+  static uint32_t hash_programs(const std::vector<std::vector<uint8_t>> &programs)
+  {
+    uint32_t hash = 2166136261u;
+    for (size_t p = 0; p < programs.size(); p++)
+    {
+      for (size_t i = 0; i < programs[p].size(); i++)
+        hash = (hash ^ programs[p][i]) * 16777619u;
+      hash = (hash ^ 0xFF) * 16777619u; // Separatore: immagini vuote diverse da assenti
+    }
+    return hash;
+  }
+
+  void append_number(long value)
+  {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%ld", value);
+    draft_ += buffer;
+  }
+
+  void append_decimal(const VmcSnapshot &snapshot, const char *name, uint16_t address)
+  {
+    uint16_t raw;
+    draft_ += ",\"";
+    draft_ += name;
+    draft_ += "\":";
+    if (!snapshot.read_register(address, raw))
+    {
+      draft_ += "null";
+      return;
+    }
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%.1f", (int16_t)raw / 10.0f);
+    draft_ += buffer;
+  }
+
+  void append_raw(const VmcSnapshot &snapshot, const char *name, uint16_t address)
+  {
+    uint16_t raw;
+    draft_ += ",\"";
+    draft_ += name;
+    draft_ += "\":";
+    if (snapshot.read_register(address, raw))
+      append_number(raw);
+    else
+      draft_ += "null";
+  }
+
+  void render(const VmcSnapshot &snapshot, const std::vector<std::vector<uint8_t>> &programs)
+  {
+    draft_.clear();
+    draft_.reserve(4096);
+
+    draft_ += "{\"sequence\":";
+    append_number(snapshot.sequence);
+    draft_ += ",\"completed_ms\":";
+    append_number(snapshot.completed_ms);
+    draft_ += ",\"fresh\":";
+    append_number(snapshot.fresh_mask);
+
+    // Valori principali già decodificati
+    draft_ += ",\"state\":{\"valid\":";
+    append_number(snapshot.valid_mask);
+    append_decimal(snapshot, "t1", 0x0100);
+    append_decimal(snapshot, "t2", 0x0101);
+    append_decimal(snapshot, "t3", 0x0102);
+    append_decimal(snapshot, "t4", 0x0103);
+    append_raw(snapshot, "alarms", 0x0110);
+    append_raw(snapshot, "co2", 0x0113);
+    append_decimal(snapshot, "rh", 0x0114);
+    append_raw(snapshot, "mode", 0x0307);
+    append_raw(snapshot, "manual_speed", 0x0309);
+    draft_ += "}";
+
+    // Registri raw per blocco (indice = indirizzo - base)
+    draft_ += ",\"blocks\":{";
+    for (uint8_t b = 0; b < VMC_STATE_BLOCK_COUNT; b++)
+    {
+      char key[16];
+      snprintf(key, sizeof(key), "%s\"0x%04X\":", b > 0 ? "," : "", VMC_STATE_BLOCK_ADDRESS[b]);
+      draft_ += key;
+      if (!snapshot.has_block(b))
+      {
+        draft_ += "null";
+        continue;
+      }
+      draft_ += "[";
+      for (uint16_t r = 0; r < VMC_STATE_BLOCK_REGISTERS[b]; r++)
+      {
+        if (r > 0)
+          draft_ += ",";
+        append_number((snapshot.images[b][r * 2] << 8) | snapshot.images[b][r * 2 + 1]);
+      }
+      draft_ += "]";
+    }
+    draft_ += "}";
+
+    // Programmi orari nel formato dei text_sensor del Block 4
+    draft_ += ",\"programs\":[";
+    for (size_t p = 0; p < programs.size(); p++)
+    {
+      if (p > 0)
+        draft_ += ",";
+      if (programs[p].size() != 238)
+      {
+        draft_ += "null";
+        continue;
+      }
+      draft_ += "[";
+      for (int day = 1; day <= 7; day++)
+      {
+        if (day > 1)
+          draft_ += ",";
+        draft_ += parse_user_timer_program(programs[p], p + 1, day);
+      }
+      draft_ += "]";
+    }
+    draft_ += "]}";
+  }
+
+  bool ready_ = false;
+  uint32_t sequence_ = 0;
+  uint32_t programs_hash_ = 0;
+  uint32_t renders_ = 0;
+  std::string body_;
+  std::string etag_;
+  std::string draft_; // Rendering in corso, solo loop principale
+  mutable std::mutex mutex_;
+};
+
+#ifdef USE_WEBSERVER
+#include "esphome/components/web_server_base/web_server_base.h"
+
+// Handler registrato sul web server del nodo: serve solo dalla cache
+class VmcStateHttpHandler : public AsyncWebHandler
+{
+public:
+  explicit VmcStateHttpHandler(const VmcStateDocument *document) : document_(document) {}
+
+  bool canHandle(AsyncWebServerRequest *request) override
+  {
+    return request->method() == HTTP_GET && request->url() == VMC_HTTP_STATE_PATH;
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override
+  {
+    std::string if_none_match;
+    if (request->hasHeader("If-None-Match"))
+      if_none_match = request->getHeader("If-None-Match")->value().c_str();
+
+    std::string etag;
+    std::string body;
+    bool not_modified = false;
+    if (!document_->snapshot(if_none_match, etag, body, not_modified))
+    {
+      request->send(503, "text/plain", "No poll round completed yet");
+      return;
+    }
+
+    AsyncWebServerResponse *response;
+    if (not_modified)
+      response = request->beginResponse(304);
+    else
+      response = request->beginResponse(200, "application/json", body.c_str());
+    response->addHeader("ETag", etag.c_str());
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  }
+
+private:
+  const VmcStateDocument *document_;
+};
+#endif
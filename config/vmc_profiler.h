@@ -0,0 +1,222 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef USE_ESP32
+#include <ctime>
+#include <esp_heap_caps.h>
+#include "esphome/core/hal.h"
+#endif
+
+// ============================================================================
+// Tempi di esecuzione e heap delle lambda di decodifica
+// ============================================================================
+//
+// Ogni sezione strumentata (decodifica di un blocco, parsing e pubblicazione
+// dei programmi orari, scrittura dei programmi, fette di pubblicazione)
+// registra per chiamata:
+//   - durata in µs, con percentili sugli ultimi PROFILE_SAMPLES campioni e
+//     caso peggiore con ora;
+//   - heap interna e PSRAM libere e blocco libero più grande dopo la chiamata,
+//     con il minimo visto;
+//   - variazione del numero di blocchi allocati (allocazioni rimaste dopo la
+//     chiamata: ESP-IDF non ha un contatore economico delle singole malloc).
+// Le istantanee dell'heap sono prese fuori dalla misura del tempo. Con il
+// profiler disabilitato ProfileScope costa un solo confronto.
+
+enum ProfileSection : uint8_t
+{
+  PROFILE_BLK0_DECODE = 0,
+  PROFILE_BLK1_DECODE,
+  PROFILE_BLK2_DECODE,
+  PROFILE_BLK3_DECODE,
+  PROFILE_SCHEDULE_PARSE,   // Block 4: timeline e JSON dei 7 giorni
+  PROFILE_SCHEDULE_PUBLISH, // Block 4: pubblicazione dei text sensor
+  PROFILE_SCHEDULE_WRITE,   // write_complete_schedule / copy_program_image
+  PROFILE_PUBLISH_DRAIN,    // Una fetta di pubblicazione (publish_scheduler.h)
+  PROFILE_SECTIONS
+};
+
+static const char *const PROFILE_SECTION_NAMES[PROFILE_SECTIONS] = {
+    "blk0_decode", "blk1_decode", "blk2_decode", "blk3_decode", "schedule_parse", "schedule_publish", "schedule_write",
+    "publish_drain"};
+
+static const size_t PROFILE_SAMPLES = 64;
+
+struct HeapSnapshot
+{
+  uint32_t free_internal = 0;
+  uint32_t free_psram = 0;
+  uint32_t largest_internal = 0; // Blocco libero più grande (frammentazione)
+  uint32_t allocated_blocks = 0;
+};
+
+class SectionProfile
+{
+public:
+  void add(uint32_t duration_us, uint32_t timestamp, const HeapSnapshot &before, const HeapSnapshot &after)
+  {
+    samples_[calls_ % PROFILE_SAMPLES] = duration_us;
+    calls_++;
+    if (duration_us >= worst_us_)
+    {
+      worst_us_ = duration_us;
+      worst_timestamp_ = timestamp;
+    }
+    int32_t blocks = (int32_t)after.allocated_blocks - (int32_t)before.allocated_blocks;
+    last_blocks_ = blocks;
+    max_blocks_ = std::max(max_blocks_, blocks);
+    if (calls_ == 1 || after.free_internal < min_free_internal_)
+      min_free_internal_ = after.free_internal;
+  }
+
+  // Percentile (0-100) sugli ultimi PROFILE_SAMPLES campioni, nearest-rank
+  uint32_t percentile(uint8_t percent) const
+  {
+    size_t count = std::min<size_t>(calls_, PROFILE_SAMPLES);
+    if (count == 0)
+      return 0;
+    std::vector<uint32_t> sorted(samples_, samples_ + count);
+    std::sort(sorted.begin(), sorted.end());
+    size_t rank = (percent * count + 99) / 100;
+    return sorted[rank == 0 ? 0 : rank - 1];
+  }
+
+  uint32_t calls() const { return calls_; }
+  uint32_t worst_us() const { return worst_us_; }
+  uint32_t worst_timestamp() const { return worst_timestamp_; }
+  int32_t last_blocks() const { return last_blocks_; }
+  int32_t max_blocks() const { return max_blocks_; }
+  uint32_t min_free_internal() const { return min_free_internal_; }
+
+  // "p50 120 / p95 310 / p99 400 / max 950 us, +2 blocks"
+  std::string summary() const
+  {
+    if (calls_ == 0)
+      return "no samples";
+    char text[96];
+    snprintf(text, sizeof(text), "p50 %u / p95 %u / p99 %u / max %u us, %+d blocks", (unsigned)percentile(50),
+             (unsigned)percentile(95), (unsigned)percentile(99), (unsigned)worst_us_, (int)max_blocks_);
+    return text;
+  }
+
+  std::string to_json() const
+  {
+    char json[192];
+    snprintf(json, sizeof(json),
+             "{\"calls\":%u,\"p50\":%u,\"p95\":%u,\"p99\":%u,\"worst\":%u,\"worst_time\":%u,\"blocks\":%d,\"max_blocks\":%d,"
+             "\"min_free_internal\":%u}",
+             (unsigned)calls_, (unsigned)percentile(50), (unsigned)percentile(95), (unsigned)percentile(99),
+             (unsigned)worst_us_, (unsigned)worst_timestamp_, (int)last_blocks_, (int)max_blocks_,
+             (unsigned)min_free_internal_);
+    return json;
+  }
+
+private:
+  uint32_t samples_[PROFILE_SAMPLES] = {};
+  uint32_t calls_ = 0;
+  uint32_t worst_us_ = 0;
+  uint32_t worst_timestamp_ = 0; // Epoch, 0 se l'ora non era valida
+  int32_t last_blocks_ = 0;
+  int32_t max_blocks_ = 0;
+  uint32_t min_free_internal_ = 0;
+};
+
+class VmcProfiler
+{
+public:
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+  bool enabled() const { return enabled_; }
+
+  void record(ProfileSection section, uint32_t duration_us, uint32_t timestamp, const HeapSnapshot &before,
+              const HeapSnapshot &after)
+  {
+    sections_[section].add(duration_us, timestamp, before, after);
+    if (!has_heap_)
+    {
+      low_water_ = after;
+      has_heap_ = true;
+    }
+    low_water_.free_internal = std::min(low_water_.free_internal, after.free_internal);
+    low_water_.free_psram = std::min(low_water_.free_psram, after.free_psram);
+    low_water_.largest_internal = std::min(low_water_.largest_internal, after.largest_internal);
+  }
+
+  const SectionProfile &section(ProfileSection section) const { return sections_[section]; }
+  // Minimi di heap, PSRAM e blocco più grande visti dopo le sezioni strumentate
+  const HeapSnapshot &low_water() const { return low_water_; }
+
+  void reset()
+  {
+    for (size_t i = 0; i < PROFILE_SECTIONS; i++)
+      sections_[i] = SectionProfile();
+    low_water_ = HeapSnapshot();
+    has_heap_ = false;
+  }
+
+  // {"blk0_decode": {...}, ..., "low_water": {...}}
+  std::string to_json() const
+  {
+    std::string json = "{";
+    for (size_t i = 0; i < PROFILE_SECTIONS; i++)
+      json += std::string("\"") + PROFILE_SECTION_NAMES[i] + "\":" + sections_[i].to_json() + ",";
+    char heap[128];
+    snprintf(heap, sizeof(heap), "\"low_water\":{\"free_internal\":%u,\"free_psram\":%u,\"largest_internal\":%u}}",
+             (unsigned)low_water_.free_internal, (unsigned)low_water_.free_psram, (unsigned)low_water_.largest_internal);
+    return json + heap;
+  }
+
+private:
+  bool enabled_ = false;
+  SectionProfile sections_[PROFILE_SECTIONS];
+  HeapSnapshot low_water_;
+  bool has_heap_ = false;
+};
+
+#ifdef USE_ESP32
+inline HeapSnapshot heap_snapshot()
+{
+  HeapSnapshot snapshot;
+  snapshot.free_internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  snapshot.free_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  snapshot.largest_internal = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  snapshot.allocated_blocks = info.allocated_blocks;
+  return snapshot;
+}
+
+// Misura il blocco in cui è dichiarato:
+//   ProfileScope profile(id(vmc_profiler), PROFILE_BLK1_DECODE);
+class ProfileScope
+{
+public:
+  ProfileScope(VmcProfiler &profiler, ProfileSection section)
+      : profiler_(profiler), section_(section), active_(profiler.enabled())
+  {
+    if (!active_)
+      return;
+    before_ = heap_snapshot();
+    start_us_ = esphome::micros();
+  }
+
+  ~ProfileScope()
+  {
+    if (!active_)
+      return;
+    uint32_t duration_us = esphome::micros() - start_us_;
+    time_t now = ::time(nullptr);
+    profiler_.record(section_, duration_us, now > 1000000000 ? (uint32_t)now : 0, before_, heap_snapshot());
+  }
+
+private:
+  VmcProfiler &profiler_;
+  ProfileSection section_;
+  bool active_;
+  HeapSnapshot before_;
+  uint32_t start_us_ = 0;
+};
+#endif
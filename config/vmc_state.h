@@ -0,0 +1,223 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// ============================================================================
+// Stato coerente della VMC per round di polling (Block 0-3)
+// ============================================================================
+//
+// I lambda dei blocchi copiano l'immagine raw ricevuta nel buffer di lavoro
+// (store_block / fail_block). Quando tutti i blocchi del round hanno risposto,
+// quando ModbusLinkMonitor chiude il round per timeout (commit() dal YAML, vedi
+// consume_round_closed()) o quando arriva di nuovo un blocco già ricevuto, il
+// buffer di lavoro diventa quello pubblicato con un nuovo numero di sequenza.
+// current() ritorna il riferimento al buffer pubblicato: nessuna copia, e tutti
+// i valori appartengono allo stesso round (i blocchi non ricevuti restano quelli
+// del round precedente, con il proprio block_sequence).
+// Indici dei blocchi: VmcLinkBlock (modbus_link.h).
+
+static const uint8_t VMC_STATE_BLOCK_COUNT = 4;
+static const uint16_t VMC_STATE_MAX_BLOCK_SIZE = 102; // Block 2
+
+// Indirizzo iniziale e numero di registri dei blocchi letti ad ogni round
+static const uint16_t VMC_STATE_BLOCK_ADDRESS[VMC_STATE_BLOCK_COUNT] = {0x0000, 0x0100, 0x0200, 0x0300};
+static const uint16_t VMC_STATE_BLOCK_REGISTERS[VMC_STATE_BLOCK_COUNT] = {14, 35, 51, 17};
+
+struct VmcSnapshot
+{
+  uint32_t sequence = 0;      // Round pubblicati finora (0 = nessuno)
+  uint32_t completed_ms = 0;  // millis() alla pubblicazione
+  uint8_t fresh_mask = 0;     // Blocchi ricevuti in questo round
+  uint8_t valid_mask = 0;     // Blocchi ricevuti almeno una volta
+  uint32_t block_sequence[VMC_STATE_BLOCK_COUNT] = {};
+  uint8_t images[VMC_STATE_BLOCK_COUNT][VMC_STATE_MAX_BLOCK_SIZE] = {};
+
+  bool has_block(uint8_t block) const { return block < VMC_STATE_BLOCK_COUNT && (valid_mask & (1 << block)); }
+
+  // Registro per indirizzo assoluto (es. 0x0307); false se non letto o fuori dai blocchi
+  bool read_register(uint16_t address, uint16_t &value) const
+  {
+    for (uint8_t b = 0; b < VMC_STATE_BLOCK_COUNT; b++)
+    {
+      if (address < VMC_STATE_BLOCK_ADDRESS[b] || address >= VMC_STATE_BLOCK_ADDRESS[b] + VMC_STATE_BLOCK_REGISTERS[b])
+        continue;
+      if (!has_block(b))
+        return false;
+      uint16_t offset = (address - VMC_STATE_BLOCK_ADDRESS[b]) * 2;
+      value = (images[b][offset] << 8) | images[b][offset + 1];
+      return true;
+    }
+    return false;
+  }
+
+  // Registro S_WORD in decimi (temperature, soglie); NAN se non disponibile
+  float read_decimal(uint16_t address) const
+  {
+    uint16_t raw;
+    if (!read_register(address, raw))
+      return NAN;
+    return (int16_t)raw / 10.0f;
+  }
+};
+
+class VmcState
+{
+public:
+  // Immagine valida ricevuta dal lambda del blocco
+  void store_block(uint8_t block, const std::vector<uint8_t> &data, uint32_t now_ms)
+  {
+    if (block >= VMC_STATE_BLOCK_COUNT || data.size() != VMC_STATE_BLOCK_REGISTERS[block] * 2u)
+    {
+      fail_block(block, now_ms);
+      return;
+    }
+    begin(block, now_ms);
+    VmcSnapshot &back = buffers_[1 - front_];
+    std::memcpy(back.images[block], data.data(), data.size());
+    back.fresh_mask |= 1 << block;
+    back.valid_mask |= 1 << block;
+    back.block_sequence[block] = back.sequence;
+    end_block(block, now_ms);
+  }
+
+  // Risposta errata o assente: il blocco resta quello del round precedente
+  void fail_block(uint8_t block, uint32_t now_ms)
+  {
+    if (block >= VMC_STATE_BLOCK_COUNT)
+      return;
+    begin(block, now_ms);
+    end_block(block, now_ms);
+  }
+
+  // Pubblica il round in corso anche se incompleto (es. timeout del round)
+  void commit(uint32_t now_ms)
+  {
+    if (reported_mask_ == 0)
+      return;
+    VmcSnapshot &back = buffers_[1 - front_];
+    back.completed_ms = now_ms;
+    front_ = 1 - front_;
+    reported_mask_ = 0;
+    new_round_ = true;
+  }
+
+  // Il riferimento resta coerente fino all'inizio del round successivo: va
+  // richiesto ad ogni uso, non conservato tra un loop e l'altro
+  const VmcSnapshot &current() const { return buffers_[front_]; }
+  uint32_t sequence() const { return buffers_[front_].sequence; }
+
+  // True una sola volta per ogni round pubblicato
+  bool consume_new_round()
+  {
+    bool result = new_round_;
+    new_round_ = false;
+    return result;
+  }
+
+private:
+  void begin(uint8_t block, uint32_t now_ms)
+  {
+    // Blocco già ricevuto: è iniziato un nuovo round senza che il precedente finisse
+    if (reported_mask_ & (1 << block))
+      commit(now_ms);
+
+    if (reported_mask_ == 0)
+    {
+      // Nuovo round: parte dallo stato pubblicato
+      VmcSnapshot &back = buffers_[1 - front_];
+      back = buffers_[front_];
+      back.sequence = buffers_[front_].sequence + 1;
+      back.fresh_mask = 0;
+    }
+  }
+
+  void end_block(uint8_t block, uint32_t now_ms)
+  {
+    reported_mask_ |= 1 << block;
+    if (reported_mask_ == (1 << VMC_STATE_BLOCK_COUNT) - 1)
+      commit(now_ms);
+  }
+
+  VmcSnapshot buffers_[2];
+  uint8_t front_ = 0;
+  uint8_t reported_mask_ = 0;
+  bool new_round_ = false;
+};
+
+// ============================================================================
+// Blob compatto dello stato (un messaggio per round)
+// ============================================================================
+//
+// Formato:
+//   [0-1]  magic 'V' 'S'
+//   [2]    schema (VMC_STATE_SCHEMA_ID): indirizzi e dimensioni dei blocchi
+//   [3]    fresh_mask
+//   [4]    valid_mask: i blocchi presenti seguono in ordine, senza separatori
+//   [5-8]  sequence (big-endian)
+//   [...]  immagini raw dei blocchi in valid_mask (28, 70, 102, 34 byte)
+//   [n-2, n-1] CRC16 Modbus dei byte precedenti, byte basso per primo
+// Il decoder lato collettore usa le stesse tabelle VMC_STATE_BLOCK_*: lo schema
+// va incrementato se cambiano.
+
+static const uint8_t VMC_STATE_SCHEMA_ID = 1;
+static const size_t VMC_STATE_BLOB_HEADER_SIZE = 9;
+
+// Serializza lo snapshot in out (riutilizzabile tra un round e l'altro); ritorna la dimensione
+inline size_t vmc_state_pack(const VmcSnapshot &snapshot, std::vector<uint8_t> &out)
+{
+  out.clear();
+  out.push_back('V');
+  out.push_back('S');
+  out.push_back(VMC_STATE_SCHEMA_ID);
+  out.push_back(snapshot.fresh_mask);
+  out.push_back(snapshot.valid_mask);
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out.push_back((snapshot.sequence >> shift) & 0xFF);
+
+  for (uint8_t b = 0; b < VMC_STATE_BLOCK_COUNT; b++)
+    if (snapshot.has_block(b))
+      out.insert(out.end(), snapshot.images[b], snapshot.images[b] + VMC_STATE_BLOCK_REGISTERS[b] * 2);
+
+  uint16_t crc = modbusCrc16(out, 0, out.size());
+  out.push_back(crc & 0xFF);
+  out.push_back(crc >> 8);
+  return out.size();
+}
+
+// Decodifica un blob (lato collettore o test); false se non valido
+inline bool vmc_state_unpack(const std::vector<uint8_t> &blob, VmcSnapshot &snapshot)
+{
+  if (blob.size() < VMC_STATE_BLOB_HEADER_SIZE + 2 || blob[0] != 'V' || blob[1] != 'S' ||
+      blob[2] != VMC_STATE_SCHEMA_ID)
+    return false;
+
+  uint16_t crc = blob[blob.size() - 2] | (blob[blob.size() - 1] << 8);
+  if (modbusCrc16(blob, 0, blob.size() - 2) != crc)
+    return false;
+
+  uint8_t valid_mask = blob[4];
+  size_t expected = VMC_STATE_BLOB_HEADER_SIZE + 2;
+  for (uint8_t b = 0; b < VMC_STATE_BLOCK_COUNT; b++)
+    if (valid_mask & (1 << b))
+      expected += VMC_STATE_BLOCK_REGISTERS[b] * 2;
+  if (blob.size() != expected)
+    return false;
+
+  snapshot = VmcSnapshot();
+  snapshot.fresh_mask = blob[3];
+  snapshot.valid_mask = valid_mask;
+  snapshot.sequence = ((uint32_t)blob[5] << 24) | ((uint32_t)blob[6] << 16) | ((uint32_t)blob[7] << 8) | blob[8];
+
+  size_t offset = VMC_STATE_BLOB_HEADER_SIZE;
+  for (uint8_t b = 0; b < VMC_STATE_BLOCK_COUNT; b++)
+  {
+    if (!(valid_mask & (1 << b)))
+      continue;
+    size_t size = VMC_STATE_BLOCK_REGISTERS[b] * 2;
+    std::memcpy(snapshot.images[b], &blob[offset], size);
+    offset += size;
+  }
+  return true;
+}
@@ -24,6 +24,184 @@ g++ -std=c++11 \
     -pthread \
     -o test_modbus_helpers
 
+# Compila test per modbus_link
+echo "Building test_modbus_link..."
+g++ -std=c++11 \
+    test_modbus_link.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_modbus_link
+
+# Compila test per demand_control
+echo "Building test_demand_control..."
+g++ -std=c++11 \
+    test_demand_control.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_demand_control
+
+# Compila test per vmc_fast_path
+echo "Building test_vmc_fast_path..."
+g++ -std=c++11 \
+    test_vmc_fast_path.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_vmc_fast_path
+
+# Compila test per vmc_capabilities
+echo "Building test_vmc_capabilities..."
+g++ -std=c++11 \
+    test_vmc_capabilities.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_vmc_capabilities
+
+# Compila test per modbus_baud
+echo "Building test_modbus_baud..."
+g++ -std=c++11 \
+    test_modbus_baud.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_modbus_baud
+
+# Compila test per Blk2_MachineParameters
+echo "Building test_Blk2_MachineParameters..."
+g++ -std=c++11 \
+    test_Blk2_MachineParameters.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_Blk2_MachineParameters
+
+# Compila test per vmc_state
+echo "Building test_vmc_state..."
+g++ -std=c++11 \
+    test_vmc_state.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_vmc_state
+
+# Compila test per vmc_http_state
+echo "Building test_vmc_http_state..."
+g++ -std=c++11 \
+    test_vmc_http_state.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_vmc_http_state
+
+# Compila test per modbus_tcp_gateway
+echo "Building test_modbus_tcp_gateway..."
+g++ -std=c++11 \
+    test_modbus_tcp_gateway.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_modbus_tcp_gateway
+
+# Compila test per modbus_sniffer
+echo "Building test_modbus_sniffer..."
+g++ -std=c++11 \
+    test_modbus_sniffer.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_modbus_sniffer
+
+# Compila test per modbus_arbiter
+echo "Building test_modbus_arbiter..."
+g++ -std=c++11 \
+    test_modbus_arbiter.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_modbus_arbiter
+
+# Compila test per Blk8_TimeAndDay
+echo "Building test_Blk8_TimeAndDay..."
+g++ -std=c++11 \
+    test_Blk8_TimeAndDay.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_Blk8_TimeAndDay
+
+# Compila test per modbus_write_verify
+echo "Building test_modbus_write_verify..."
+g++ -std=c++11 \
+    test_modbus_write_verify.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_modbus_write_verify
+
+# Compila test per modbus_capture
+echo "Building test_modbus_capture..."
+g++ -std=c++11 \
+    test_modbus_capture.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_modbus_capture
+
+# Compila test per alarm_journal
+echo "Building test_alarm_journal..."
+g++ -std=c++11 \
+    test_alarm_journal.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_alarm_journal
+
+# Compila test per vmc_profiler
+echo "Building test_vmc_profiler..."
+g++ -std=c++11 \
+    test_vmc_profiler.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_vmc_profiler
+
+# Compila test per publish_scheduler
+echo "Building test_publish_scheduler..."
+g++ -std=c++11 \
+    test_publish_scheduler.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_publish_scheduler
+
+# Compila test per relay_rules
+echo "Building test_relay_rules..."
+g++ -std=c++11 \
+    test_relay_rules.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_relay_rules
+
+# Compila test per seasonal_controller
+echo "Building test_seasonal_controller..."
+g++ -std=c++11 \
+    test_seasonal_controller.cpp \
+    -lgtest \
+    -lgtest_main \
+    -pthread \
+    -o test_seasonal_controller
+
+# Compila lo strumento di replay delle catture
+echo "Building replay_capture..."
+g++ -std=c++11 -O2 \
+    replay_capture.cpp \
+    -pthread \
+    -o replay_capture
+
 echo ""
 echo "==================================="
 echo "Running Tests"
@@ -39,6 +217,126 @@ echo ""
 echo "Running modbus_helpers tests..."
 ./test_modbus_helpers
 
+echo ""
+
+# Esegui test per modbus_link
+echo "Running modbus_link tests..."
+./test_modbus_link
+
+echo ""
+
+# Esegui test per demand_control
+echo "Running demand_control tests..."
+./test_demand_control
+
+echo ""
+
+# Esegui test per vmc_fast_path
+echo "Running vmc_fast_path tests..."
+./test_vmc_fast_path
+
+echo ""
+
+# Esegui test per vmc_capabilities
+echo "Running vmc_capabilities tests..."
+./test_vmc_capabilities
+
+echo ""
+
+# Esegui test per modbus_baud
+echo "Running modbus_baud tests..."
+./test_modbus_baud
+
+echo ""
+
+# Esegui test per Blk2_MachineParameters
+echo "Running Blk2_MachineParameters tests..."
+./test_Blk2_MachineParameters
+
+echo ""
+
+# Esegui test per vmc_state
+echo "Running vmc_state tests..."
+./test_vmc_state
+
+echo ""
+
+# Esegui test per vmc_http_state
+echo "Running vmc_http_state tests..."
+./test_vmc_http_state
+
+echo ""
+
+# Esegui test per modbus_tcp_gateway
+echo "Running modbus_tcp_gateway tests..."
+./test_modbus_tcp_gateway
+
+echo ""
+
+# Esegui test per modbus_sniffer
+echo "Running modbus_sniffer tests..."
+./test_modbus_sniffer
+
+echo ""
+
+# Esegui test per modbus_arbiter
+echo "Running modbus_arbiter tests..."
+./test_modbus_arbiter
+
+echo ""
+
+# Esegui test per Blk8_TimeAndDay
+echo "Running Blk8_TimeAndDay tests..."
+./test_Blk8_TimeAndDay
+
+echo ""
+
+# Esegui test per modbus_write_verify
+echo "Running modbus_write_verify tests..."
+./test_modbus_write_verify
+
+echo ""
+
+# Esegui test per modbus_capture
+echo "Running modbus_capture tests..."
+./test_modbus_capture
+
+echo ""
+
+# Esegui test per alarm_journal
+echo "Running alarm_journal tests..."
+./test_alarm_journal
+
+echo ""
+
+# Esegui test per vmc_profiler
+echo "Running vmc_profiler tests..."
+./test_vmc_profiler
+
+echo ""
+
+# Esegui test per publish_scheduler
+echo "Running publish_scheduler tests..."
+./test_publish_scheduler
+
+echo ""
+
+# Esegui test per relay_rules
+echo "Running relay_rules tests..."
+./test_relay_rules
+
+echo ""
+
+# Esegui test per seasonal_controller
+echo "Running seasonal_controller tests..."
+./test_seasonal_controller
+
+echo ""
+
+# Replay della cattura d'esempio scritta da test_modbus_capture
+echo "Running replay_capture on sample_capture.bin..."
+./replay_capture sample_capture.bin
+
 echo ""
 echo "==================================="
 echo "Tests Completed Successfully!"
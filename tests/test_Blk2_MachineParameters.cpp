@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// Mock del ModbusController e ModbusCommandItem
+namespace modbus_controller
+{
+    class ModbusCommandItem
+    {
+    public:
+        uint16_t address = 0;
+        uint16_t count = 0;
+        std::vector<uint16_t> values;
+
+        static std::shared_ptr<ModbusCommandItem> create_write_multiple_command(
+            class ModbusController *controller, uint16_t address, uint16_t count, const std::vector<uint16_t> &values)
+        {
+            auto cmd = std::make_shared<ModbusCommandItem>();
+            cmd->address = address;
+            cmd->count = count;
+            cmd->values = values;
+            return cmd;
+        }
+    };
+
+    class ModbusController
+    {
+    public:
+        std::vector<std::shared_ptr<ModbusCommandItem>> commands;
+
+        void queue_command(std::shared_ptr<ModbusCommandItem> command) { commands.push_back(command); }
+    };
+}
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_helpers.h"
+#include "../config/Blk2_MachineParameters.h"
+
+// ============================================================================
+// HELPER
+// ============================================================================
+
+// Immagine di prova: registro i = 0x0100 + i
+static std::vector<uint8_t> make_image()
+{
+    std::vector<uint8_t> image;
+    for (uint16_t i = 0; i < BLK2_REGISTER_COUNT; i++)
+    {
+        image.push_back(0x01);
+        image.push_back(i);
+    }
+    return image;
+}
+
+static void set_register(std::vector<uint8_t> &image, uint16_t address, uint16_t value)
+{
+    uint16_t index = address - BLK2_ADDRESS;
+    image[index * 2] = value >> 8;
+    image[index * 2 + 1] = value & 0xFF;
+}
+
+// ============================================================================
+// TEST: formato dello snapshot
+// ============================================================================
+
+TEST(Blk2SnapshotTest, RoundTripsThroughHex)
+{
+    std::vector<uint8_t> image = make_image();
+    std::vector<uint8_t> blob = blk2_make_snapshot(image, 0x5301);
+    ASSERT_EQ(blob.size(), BLK2_SNAPSHOT_SIZE);
+
+    std::string hex = blk2_to_hex(blob);
+    EXPECT_EQ(hex.size(), 220u);
+    EXPECT_EQ(hex.substr(0, 12), "423201335301");
+
+    std::vector<uint8_t> parsed_blob;
+    ASSERT_TRUE(blk2_from_hex(hex, parsed_blob));
+    std::vector<uint8_t> parsed;
+    EXPECT_EQ(blk2_parse_snapshot(parsed_blob, 0x5301, parsed), Blk2SnapshotResult::OK);
+    EXPECT_EQ(parsed, image);
+}
+
+TEST(Blk2SnapshotTest, AcceptsLowercaseHexAndRejectsGarbage)
+{
+    std::vector<uint8_t> blob;
+    EXPECT_TRUE(blk2_from_hex("0aFf", blob));
+    EXPECT_EQ(blob, (std::vector<uint8_t>{0x0A, 0xFF}));
+
+    EXPECT_FALSE(blk2_from_hex("0aF", blob));
+    EXPECT_FALSE(blk2_from_hex("0x12", blob));
+}
+
+TEST(Blk2SnapshotTest, RejectsInvalidImageSize)
+{
+    std::vector<uint8_t> image(100, 0);
+    EXPECT_TRUE(blk2_make_snapshot(image, 0).empty());
+}
+
+TEST(Blk2SnapshotTest, DetectsCorruption)
+{
+    std::vector<uint8_t> blob = blk2_make_snapshot(make_image(), 0x5301);
+    std::vector<uint8_t> image;
+
+    std::vector<uint8_t> corrupted = blob;
+    corrupted[40] ^= 0x01;
+    EXPECT_EQ(blk2_parse_snapshot(corrupted, 0, image), Blk2SnapshotResult::BAD_CRC);
+
+    corrupted = blob;
+    corrupted[0] = 'X';
+    EXPECT_EQ(blk2_parse_snapshot(corrupted, 0, image), Blk2SnapshotResult::BAD_MAGIC);
+
+    corrupted = blob;
+    corrupted[2] = BLK2_SNAPSHOT_VERSION + 1;
+    EXPECT_EQ(blk2_parse_snapshot(corrupted, 0, image), Blk2SnapshotResult::BAD_VERSION);
+
+    corrupted = blob;
+    corrupted.pop_back();
+    EXPECT_EQ(blk2_parse_snapshot(corrupted, 0, image), Blk2SnapshotResult::BAD_SIZE);
+}
+
+TEST(Blk2SnapshotTest, ChecksModelOnlyWhenBothKnown)
+{
+    std::vector<uint8_t> image;
+
+    std::vector<uint8_t> blob = blk2_make_snapshot(make_image(), 0x5301);
+    EXPECT_EQ(blk2_parse_snapshot(blob, 0x5200, image), Blk2SnapshotResult::MODEL_MISMATCH);
+    EXPECT_EQ(blk2_parse_snapshot(blob, 0, image), Blk2SnapshotResult::OK);
+
+    std::vector<uint8_t> generic = blk2_make_snapshot(make_image(), 0);
+    EXPECT_EQ(blk2_parse_snapshot(generic, 0x5200, image), Blk2SnapshotResult::OK);
+}
+
+// ============================================================================
+// TEST: confronto e piano di ripristino
+// ============================================================================
+
+TEST(Blk2RestoreTest, IdenticalImagesNeedNoWrites)
+{
+    std::vector<uint8_t> image = make_image();
+
+    EXPECT_TRUE(blk2_diff(image, image).empty());
+    EXPECT_TRUE(blk2_restore_plan(image, image).empty());
+}
+
+TEST(Blk2RestoreTest, CoalescesContiguousRegisters)
+{
+    std::vector<uint8_t> live = make_image();
+    std::vector<uint8_t> target = live;
+    // Offset sonde T1-T4
+    set_register(target, 0x0201, 5);
+    set_register(target, 0x0202, 6);
+    set_register(target, 0x0203, 7);
+    set_register(target, 0x0204, 8);
+
+    std::vector<WriteRange> plan = blk2_restore_plan(live, target);
+
+    ASSERT_EQ(plan.size(), 1u);
+    EXPECT_EQ(plan[0].address, 0x0201);
+    EXPECT_EQ(plan[0].values, (std::vector<uint16_t>{5, 6, 7, 8}));
+}
+
+TEST(Blk2RestoreTest, BridgesSmallGapsOnly)
+{
+    std::vector<uint8_t> live = make_image();
+    std::vector<uint8_t> target = live;
+    set_register(target, 0x0213, 30); // Speed 1 %
+    set_register(target, 0x0216, 90); // Speed 4 %: buco di 2 registri
+    set_register(target, 0x0229, 40); // RH low: troppo lontano
+
+    std::vector<WriteRange> plan = blk2_restore_plan(live, target);
+
+    ASSERT_EQ(plan.size(), 2u);
+    EXPECT_EQ(plan[0].address, 0x0213);
+    ASSERT_EQ(plan[0].values.size(), 4u);
+    EXPECT_EQ(plan[0].values[0], 30);
+    EXPECT_EQ(plan[0].values[1], blk2_register(live, 0x14)); // Valore attuale riscritto
+    EXPECT_EQ(plan[0].values[3], 90);
+    EXPECT_EQ(plan[1].address, 0x0229);
+    EXPECT_EQ(plan[1].values.size(), 1u);
+}
+
+TEST(Blk2RestoreTest, SkipsRegistersOutsideWhitelist)
+{
+    std::vector<uint8_t> live = make_image();
+    std::vector<uint8_t> target = live;
+    set_register(target, 0x0200, 0x0008); // Flag (velocità del bus)
+    set_register(target, 0x0212, 3);      // Velocità manuale
+    set_register(target, 0x0211, 200);
+    set_register(target, 0x0213, 50);
+
+    EXPECT_EQ(blk2_diff(live, target).size(), 4u);
+
+    // 0x0211 e 0x0213 non vengono uniti attraverso 0x0212
+    std::vector<WriteRange> plan = blk2_restore_plan(live, target);
+    ASSERT_EQ(plan.size(), 2u);
+    EXPECT_EQ(plan[0].address, 0x0211);
+    EXPECT_EQ(plan[0].values.size(), 1u);
+    EXPECT_EQ(plan[1].address, 0x0213);
+    EXPECT_EQ(plan[1].values.size(), 1u);
+}
+
+TEST(Blk2RestoreTest, FullRestoreUsesFewFrames)
+{
+    std::vector<uint8_t> live(BLK2_IMAGE_SIZE, 0);
+    std::vector<uint8_t> target = make_image();
+
+    std::vector<WriteRange> plan = blk2_restore_plan(live, target);
+
+    // Tutto tranne 0x0200 e 0x0212: due intervalli
+    ASSERT_EQ(plan.size(), 2u);
+    EXPECT_EQ(plan[0].address, 0x0201);
+    EXPECT_EQ(plan[0].values.size(), 17u);
+    EXPECT_EQ(plan[1].address, 0x0213);
+    EXPECT_EQ(plan[1].values.size(), 32u);
+}
+
+TEST(Blk2RestoreTest, QueuesOneFc16PerWrite)
+{
+    std::vector<uint8_t> live = make_image();
+    std::vector<uint8_t> target = live;
+    set_register(target, 0x021B, 250);
+    set_register(target, 0x021C, 180);
+    set_register(target, 0x0230, 12);
+
+    modbus_controller::ModbusController controller;
+    blk2_queue_restore(&controller, blk2_restore_plan(live, target));
+
+    ASSERT_EQ(controller.commands.size(), 2u);
+    EXPECT_EQ(controller.commands[0]->address, 0x021B);
+    EXPECT_EQ(controller.commands[0]->count, 2);
+    EXPECT_EQ(controller.commands[0]->values, (std::vector<uint16_t>{250, 180}));
+    EXPECT_EQ(controller.commands[1]->address, 0x0230);
+    EXPECT_EQ(controller.commands[1]->count, 1);
+}
@@ -58,9 +58,11 @@ class MockModbusController : public modbus_controller::ModbusController
 {
 public:
     std::vector<std::pair<uint16_t, uint16_t>> written_values; // (address, value) - espanso dai batch
+    std::vector<std::pair<uint16_t, size_t>> frames;           // (address, registri) per ogni FC16
 
     void queue_command(std::shared_ptr<modbus_controller::ModbusCommandItem> command) override
     {
+        frames.push_back({command->address, command->values.size()});
         // Espandi il comando batch in singole coppie (address, value)
         for (size_t i = 0; i < command->values.size(); i++)
         {
@@ -323,7 +325,7 @@ TEST_F(WriteScheduleTest, VerifiesCorrectValuesWrittenForFirstInterval)
         << "First speed should be 3";
 }
 
-TEST_F(WriteScheduleTest, StopsOnInvalidJsonAtDay3)
+TEST_F(WriteScheduleTest, InvalidJsonAtDay3WritesNothing)
 {
     auto days = create_valid_week();
     days[2] = R"({"d":3,"sb":10,"i":[]})"; // speed_before invalido
@@ -331,8 +333,31 @@ TEST_F(WriteScheduleTest, StopsOnInvalidJsonAtDay3)
     bool result = write_complete_schedule(controller, 1000, days);
 
     EXPECT_FALSE(result);
-    // Dovrebbe scrivere solo i primi 2 giorni (2 * 17 = 34 registri)
-    EXPECT_EQ(controller->written_values.size(), 34);
+    // Tutto o niente: i giorni 1 e 2, validi, non vengono scritti
+    EXPECT_TRUE(controller->written_values.empty());
+}
+
+TEST_F(WriteScheduleTest, WritesWholeProgramInTwoFrames)
+{
+    auto days = create_valid_week();
+
+    EXPECT_TRUE(write_complete_schedule(controller, 0x0400, days));
+
+    ASSERT_EQ(controller->frames.size(), 2u);
+    EXPECT_EQ(controller->frames[0], (std::pair<uint16_t, size_t>(0x0400, 56)));
+    EXPECT_EQ(controller->frames[1], (std::pair<uint16_t, size_t>(0x0438, 63)));
+}
+
+TEST_F(WriteScheduleTest, SingleFrameWritesAll119Registers)
+{
+    auto days = create_valid_week();
+
+    EXPECT_TRUE(write_complete_schedule(controller, 0x0400, days, nullptr, true));
+
+    ASSERT_EQ(controller->frames.size(), 1u);
+    EXPECT_EQ(controller->frames[0], (std::pair<uint16_t, size_t>(0x0400, 119)));
+    EXPECT_TRUE(controller->was_written(0x0400 + 6 * 8, 0x0600));
+    EXPECT_TRUE(controller->was_written(0x0438 + 6 * 9 + 1, 3));
 }
 
 TEST_F(WriteScheduleTest, WritesTimeRegistersBeforeSpeedRegisters)
@@ -378,10 +403,14 @@ TEST_F(WriteScheduleTest, HandlesEdgeCaseTimeValues)
 
     bool result = write_complete_schedule(controller, 1000, days);
 
+    // Scritto in forma canonica: 00:00 diventa la velocità iniziale, le
+    // transizioni che non cambiano velocità spariscono, 23:59 è riempimento
     EXPECT_TRUE(result);
-    EXPECT_TRUE(controller->was_written(1000, 0x0000)) << "00:00 should be written";
-    EXPECT_TRUE(controller->was_written(1001, 0x173B)) << "23:59 should be written";
-    EXPECT_TRUE(controller->was_written(1002, 0x0C1E)) << "12:30 should be written";
+    EXPECT_TRUE(controller->was_written(1056, 0)) << "00:00 should set speed_before";
+    EXPECT_TRUE(controller->was_written(1000, 0x060F)) << "06:15 should be the first transition";
+    EXPECT_TRUE(controller->was_written(1003, 0x173A)) << "23:58 should be written";
+    EXPECT_TRUE(controller->was_written(1004, 0x173B)) << "23:59 should pad the day";
+    EXPECT_TRUE(controller->was_written(1060, 4)) << "Padding should keep the last speed";
 }
 
 TEST_F(WriteScheduleTest, HandlesSpeed255)
@@ -391,7 +420,434 @@ TEST_F(WriteScheduleTest, HandlesSpeed255)
 
     bool result = write_complete_schedule(controller, 1000, days);
 
+    // 06:00 a 255 ripete la velocità iniziale e non occupa un intervallo
     EXPECT_TRUE(result);
     EXPECT_TRUE(controller->was_written(1056, 255)) << "Speed_before should be 255";
-    EXPECT_TRUE(controller->was_written(1057, 255)) << "First speed should be 255";
-}
\ No newline at end of file
+    EXPECT_TRUE(controller->was_written(1000, 0x0800)) << "08:00 should be the first transition";
+    EXPECT_TRUE(controller->was_written(1057, 0)) << "First speed should be 0";
+}
+// ============================================================================
+// TEST: compilatore dei programmi giornalieri
+// ============================================================================
+
+static ScheduleTransition transition(int hour, int minute, uint16_t speed)
+{
+    ScheduleTransition t = {(uint16_t)(hour * 60 + minute), speed};
+    return t;
+}
+
+// Costruisce l'immagine raw (238 byte) di un programma con lo stesso giorno ripetuto 7 volte
+static std::vector<uint8_t> build_program_image(const std::vector<uint16_t> &time_regs,
+                                                const std::vector<uint16_t> &speed_regs)
+{
+    std::vector<uint8_t> data(238, 0);
+    for (int day = 0; day < 7; day++)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            data[(day * 8 + i) * 2] = time_regs[i] >> 8;
+            data[(day * 8 + i) * 2 + 1] = time_regs[i] & 0xFF;
+        }
+        for (int n = 0; n < 9; n++)
+        {
+            data[(56 + day * 9 + n) * 2] = speed_regs[n] >> 8;
+            data[(56 + day * 9 + n) * 2 + 1] = speed_regs[n] & 0xFF;
+        }
+    }
+    return data;
+}
+
+TEST(ScheduleCompilerTest, ProducesCanonicalLayoutOfExample)
+{
+    std::vector<ScheduleTransition> transitions = {
+        transition(6, 0, 3), transition(8, 0, 0), transition(17, 0, 2), transition(21, 0, 0)};
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+
+    EXPECT_EQ(compile_day_schedule(2, transitions, time_regs, speed_regs), ScheduleCompileResult::OK);
+
+    std::vector<uint16_t> expected_time = {0x0600, 0x0800, 0x1100, 0x1500, 0x173B, 0x173B, 0x173B, 0x173B};
+    std::vector<uint16_t> expected_speed = {2, 3, 0, 2, 0, 0, 0, 0, 0};
+    EXPECT_EQ(time_regs, expected_time);
+    EXPECT_EQ(speed_regs, expected_speed);
+}
+
+TEST(ScheduleCompilerTest, SortsUnorderedTransitions)
+{
+    std::vector<ScheduleTransition> transitions = {
+        transition(21, 0, 0), transition(6, 0, 3), transition(17, 0, 2), transition(8, 0, 0)};
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+
+    ASSERT_EQ(compile_day_schedule(2, transitions, time_regs, speed_regs), ScheduleCompileResult::OK);
+
+    EXPECT_EQ(time_regs[0], 0x0600);
+    EXPECT_EQ(time_regs[3], 0x1500);
+    EXPECT_EQ(speed_regs[1], 3);
+    EXPECT_EQ(speed_regs[4], 0);
+}
+
+TEST(ScheduleCompilerTest, MergesTransitionsThatDoNotChangeSpeed)
+{
+    std::vector<ScheduleTransition> transitions = {
+        transition(6, 0, 3), transition(7, 0, 3), transition(8, 0, 2), transition(9, 0, 2), transition(10, 0, 2)};
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+    size_t required = 0;
+
+    ASSERT_EQ(compile_day_schedule(3, transitions, time_regs, speed_regs, &required), ScheduleCompileResult::OK);
+
+    // sb=3 rende ridondanti 06:00 e 07:00, restano solo le 08:00
+    EXPECT_EQ(required, 1u);
+    EXPECT_EQ(time_regs[0], 0x0800);
+    EXPECT_EQ(speed_regs[0], 3);
+    EXPECT_EQ(speed_regs[1], 2);
+    EXPECT_EQ(time_regs[1], 0x173B);
+    EXPECT_EQ(speed_regs[2], 2) << "Padding must keep the active speed";
+}
+
+TEST(ScheduleCompilerTest, MidnightTransitionReplacesSpeedBefore)
+{
+    std::vector<ScheduleTransition> transitions = {transition(0, 0, 1), transition(12, 0, 4)};
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+
+    ASSERT_EQ(compile_day_schedule(3, transitions, time_regs, speed_regs), ScheduleCompileResult::OK);
+
+    EXPECT_EQ(speed_regs[0], 1);
+    EXPECT_EQ(time_regs[0], 0x0C00);
+    EXPECT_EQ(speed_regs[1], 4);
+}
+
+TEST(ScheduleCompilerTest, DropsDuplicateTransitions)
+{
+    std::vector<ScheduleTransition> transitions = {transition(6, 0, 3), transition(6, 0, 3)};
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+    size_t required = 0;
+
+    EXPECT_EQ(compile_day_schedule(2, transitions, time_regs, speed_regs, &required), ScheduleCompileResult::OK);
+    EXPECT_EQ(required, 1u);
+}
+
+TEST(ScheduleCompilerTest, RejectsConflictingTransitions)
+{
+    std::vector<ScheduleTransition> transitions = {transition(6, 0, 3), transition(6, 0, 1)};
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+
+    EXPECT_EQ(compile_day_schedule(2, transitions, time_regs, speed_regs),
+              ScheduleCompileResult::CONFLICTING_TRANSITIONS);
+}
+
+TEST(ScheduleCompilerTest, RejectsInvalidValues)
+{
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+
+    std::vector<ScheduleTransition> bad_time = {{24 * 60, 1}};
+    EXPECT_EQ(compile_day_schedule(2, bad_time, time_regs, speed_regs), ScheduleCompileResult::INVALID_TIME);
+
+    std::vector<ScheduleTransition> bad_speed = {transition(6, 0, 7)};
+    EXPECT_EQ(compile_day_schedule(2, bad_speed, time_regs, speed_regs), ScheduleCompileResult::INVALID_SPEED);
+
+    EXPECT_EQ(compile_day_schedule(9, {}, time_regs, speed_regs), ScheduleCompileResult::INVALID_SPEED);
+}
+
+TEST(ScheduleCompilerTest, ReportsDaysNeedingMoreThan8Intervals)
+{
+    std::vector<ScheduleTransition> transitions;
+    for (int hour = 1; hour <= 10; hour++)
+        transitions.push_back(transition(hour, 0, hour % 2 ? 1 : 2));
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+    size_t required = 0;
+
+    EXPECT_EQ(compile_day_schedule(0, transitions, time_regs, speed_regs, &required),
+              ScheduleCompileResult::TOO_MANY_INTERVALS);
+    EXPECT_EQ(required, 10u);
+    EXPECT_TRUE(time_regs.empty());
+    EXPECT_TRUE(speed_regs.empty());
+}
+
+TEST(ScheduleCompilerTest, CanonicalizesEquivalentRegisterLayouts)
+{
+    // Stesso programma: uno con padding a 23:59 e transizioni ridondanti, uno già canonico
+    std::vector<uint16_t> time_a = {0x0800, 0x0600, 0x0700, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B};
+    std::vector<uint16_t> speed_a = {2, 0, 3, 3, 0, 0, 0, 0, 0};
+    std::vector<uint16_t> time_b = {0x0600, 0x0800, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B};
+    std::vector<uint16_t> speed_b = {2, 3, 0, 0, 0, 0, 0, 0, 0};
+
+    ASSERT_EQ(canonicalize_schedule_registers(time_a, speed_a), ScheduleCompileResult::OK);
+    ASSERT_EQ(canonicalize_schedule_registers(time_b, speed_b), ScheduleCompileResult::OK);
+
+    EXPECT_EQ(time_a, time_b);
+    EXPECT_EQ(speed_a, speed_b);
+}
+
+TEST(ScheduleCompilerTest, RejectsMalformedRegisterLayout)
+{
+    std::vector<uint16_t> time_regs = {0x0600, 0x0800, 0x173B};
+    std::vector<uint16_t> speed_regs = {2, 3, 0, 0};
+
+    EXPECT_EQ(canonicalize_schedule_registers(time_regs, speed_regs), ScheduleCompileResult::INVALID_LAYOUT);
+}
+
+TEST(ScheduleCompilerTest, CompilesJsonWithArbitraryIntervalCount)
+{
+    std::string json = R"({"d":1,"sb":2,"i":[{"t":"17:00","s":2},{"t":"06:00","s":3},{"t":"08:00","s":0}]})";
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+
+    ASSERT_EQ(json_to_compiled_schedule_registers(json, time_regs, speed_regs), ScheduleCompileResult::OK);
+
+    EXPECT_EQ(time_regs.size(), 8u);
+    EXPECT_EQ(speed_regs.size(), 9u);
+    EXPECT_EQ(time_regs[0], 0x0600);
+    EXPECT_EQ(time_regs[2], 0x1100);
+    EXPECT_EQ(time_regs[3], 0x173B);
+    EXPECT_EQ(speed_regs[3], 2);
+}
+
+TEST_F(WriteScheduleTest, DifferentialWriteSkipsEquivalentDays)
+{
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+    ASSERT_TRUE(json_to_schedule_registers(valid_day_json, time_regs, speed_regs));
+    std::vector<uint8_t> current = build_program_image(time_regs, speed_regs);
+
+    auto days = create_valid_week();
+    // Stesso giorno 3 scritto in modo diverso ma equivalente
+    days[2] = R"({"d":3,"sb":2,"i":[{"t":"21:00","s":0},{"t":"06:00","s":3},{"t":"08:00","s":0},{"t":"17:00","s":2}]})";
+    // Giorno 5 realmente modificato
+    days[4] = R"({"d":5,"sb":2,"i":[{"t":"07:00","s":3},{"t":"08:00","s":0}]})";
+
+    EXPECT_TRUE(write_complete_schedule(controller, 1000, days, &current));
+
+    EXPECT_EQ(controller->written_values.size(), 17u) << "Only day 5 should be written";
+    EXPECT_TRUE(controller->was_written(1000 + 4 * 8, 0x0700));
+    EXPECT_TRUE(controller->was_written(1000 + 56 + 4 * 9 + 1, 3));
+}
+
+TEST_F(WriteScheduleTest, DifferentialWriteRejectsTooManyIntervals)
+{
+    std::vector<uint8_t> current(238, 0);
+    auto days = create_valid_week();
+    days[0] = R"({"d":1,"sb":0,"i":[{"t":"01:00","s":1},{"t":"02:00","s":2},{"t":"03:00","s":1},{"t":"04:00","s":2},{"t":"05:00","s":1},{"t":"06:00","s":2},{"t":"07:00","s":1},{"t":"08:00","s":2},{"t":"09:00","s":1}]})";
+
+    EXPECT_FALSE(write_complete_schedule(controller, 1000, days, &current));
+    EXPECT_TRUE(controller->written_values.empty());
+}
+
+TEST_F(WriteScheduleTest, DifferentialWriteSpansFirstToLastChangedDay)
+{
+    // Programma corrente con registri non canonici (transizione delle 21:00 ripetuta)
+    std::vector<uint16_t> time_regs = {0x0600, 0x0800, 0x1100, 0x1500, 0x1500, 0x173B, 0x173B, 0x173B};
+    std::vector<uint16_t> speed_regs = {2, 3, 0, 2, 0, 0, 0, 0, 0};
+    std::vector<uint8_t> current = build_program_image(time_regs, speed_regs);
+
+    auto days = create_valid_week();
+    days[1] = R"({"d":2,"sb":1,"i":[{"t":"07:00","s":3}]})";
+    days[4] = R"({"d":5,"sb":2,"i":[{"t":"07:00","s":3},{"t":"08:00","s":0}]})";
+
+    EXPECT_TRUE(write_complete_schedule(controller, 1000, days, &current));
+
+    // Giorni 2-5 in due frame; i giorni 3 e 4 mantengono i registri letti
+    ASSERT_EQ(controller->frames.size(), 2u);
+    EXPECT_EQ(controller->frames[0], (std::pair<uint16_t, size_t>(1000 + 8, 32)));
+    EXPECT_EQ(controller->frames[1], (std::pair<uint16_t, size_t>(1000 + 56 + 9, 36)));
+    EXPECT_TRUE(controller->was_written(1000 + 2 * 8 + 4, 0x1500));
+    EXPECT_EQ(controller->count_writes_to_address(1000), 0);
+}
+
+TEST_F(WriteScheduleTest, DifferentialSingleFrameKeepsRegistersInBetween)
+{
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+    ASSERT_TRUE(json_to_schedule_registers(valid_day_json, time_regs, speed_regs));
+    std::vector<uint8_t> current = build_program_image(time_regs, speed_regs);
+
+    auto days = create_valid_week();
+    days[6] = R"({"d":7,"sb":0,"i":[]})";
+
+    EXPECT_TRUE(write_complete_schedule(controller, 1000, days, &current, true));
+
+    // Dagli orari del giorno 7 alle sue velocità: 8 + 54 (invariati) + 9 registri
+    ASSERT_EQ(controller->frames.size(), 1u);
+    EXPECT_EQ(controller->frames[0], (std::pair<uint16_t, size_t>(1000 + 48, 71)));
+    EXPECT_TRUE(controller->was_written(1000 + 56, 2));
+    EXPECT_TRUE(controller->was_written(1000 + 56 + 6 * 9, 0));
+}
+
+TEST_F(WriteScheduleTest, UnchangedProgramWritesNothing)
+{
+    std::vector<uint16_t> time_regs;
+    std::vector<uint16_t> speed_regs;
+    ASSERT_TRUE(json_to_schedule_registers(valid_day_json, time_regs, speed_regs));
+    std::vector<uint8_t> current = build_program_image(time_regs, speed_regs);
+
+    EXPECT_TRUE(write_complete_schedule(controller, 1000, create_valid_week(), &current));
+    EXPECT_TRUE(controller->frames.empty());
+}
+
+TEST_F(WriteScheduleTest, WithoutCacheWritesEveryDay)
+{
+    std::vector<uint8_t> empty_cache;
+    auto days = create_valid_week();
+
+    EXPECT_TRUE(write_complete_schedule(controller, 1000, days, &empty_cache));
+    EXPECT_EQ(controller->written_values.size(), 119u);
+}
+
+// ============================================================================
+// TEST: copia di un programma
+// ============================================================================
+
+TEST_F(WriteScheduleTest, CopiesProgramImageInTwoFrames)
+{
+    std::vector<uint8_t> source = build_program_image({0x0600, 0x0800, 0x1100, 0x1500, 0x1500, 0x173B, 0x173B, 0x173B},
+                                                      {2, 3, 0, 2, 0, 0, 0, 0, 255});
+
+    EXPECT_TRUE(copy_program_image(controller, source, 0x0600));
+
+    ASSERT_EQ(controller->frames.size(), 2u);
+    EXPECT_EQ(controller->frames[0], (std::pair<uint16_t, size_t>(0x0600, 56)));
+    EXPECT_EQ(controller->frames[1], (std::pair<uint16_t, size_t>(0x0638, 63)));
+    // Copia registro per registro, senza ricompilare la forma canonica
+    EXPECT_TRUE(controller->was_written(0x0600 + 6 * 8 + 4, 0x1500));
+    EXPECT_TRUE(controller->was_written(0x0638 + 6 * 9 + 8, 255));
+}
+
+TEST_F(WriteScheduleTest, CopiesProgramImageInSingleFrame)
+{
+    std::vector<uint8_t> source = build_program_image({0x0600, 0x0800, 0x1100, 0x1500, 0x173B, 0x173B, 0x173B, 0x173B},
+                                                      {2, 3, 0, 2, 0, 0, 0, 0, 0});
+
+    EXPECT_TRUE(copy_program_image(controller, source, 0x0700, true));
+
+    ASSERT_EQ(controller->frames.size(), 1u);
+    EXPECT_EQ(controller->frames[0], (std::pair<uint16_t, size_t>(0x0700, 119)));
+}
+
+TEST_F(WriteScheduleTest, CopyRejectsMissingOrInvalidSource)
+{
+    std::vector<uint8_t> not_read;
+    EXPECT_FALSE(copy_program_image(controller, not_read, 0x0500));
+
+    std::vector<uint8_t> corrupted = build_program_image({0x0600, 0x0800, 0x1100, 0x1500, 0x173B, 0x173B, 0x173B, 0x173B},
+                                                         {2, 3, 0, 2, 0, 0, 0, 0, 0});
+    corrupted[(56 + 3 * 9 + 2) * 2 + 1] = 7; // Velocità 7 nel giorno 4
+    EXPECT_FALSE(copy_program_image(controller, corrupted, 0x0500));
+
+    EXPECT_TRUE(controller->frames.empty());
+}
+
+// ============================================================================
+// TEST: timeline settimanale compressa
+// ============================================================================
+
+// Giorno dell'esempio: sb=2, 06:00->3, 08:00->0, 17:00->2, 21:00->0
+static std::vector<uint8_t> example_program_image()
+{
+    return build_program_image({0x0600, 0x0800, 0x1100, 0x1500, 0x173B, 0x173B, 0x173B, 0x173B},
+                               {2, 3, 0, 2, 0, 0, 0, 0, 0});
+}
+
+TEST(SpeedTimelineTest, BuildsRunsFromProgramImage)
+{
+    SpeedTimeline timeline;
+    ASSERT_TRUE(timeline.build(example_program_image()));
+
+    const std::vector<SpeedRun> &runs = timeline.runs();
+    ASSERT_EQ(runs.size(), 35u);
+    EXPECT_EQ(runs[0].start, 0);
+    EXPECT_EQ(runs[0].speed, 2);
+    EXPECT_EQ(runs[1].start, 360);
+    EXPECT_EQ(runs[1].speed, 3);
+    EXPECT_EQ(runs[5].start, 1440); // Martedì 00:00
+    EXPECT_EQ(runs[5].speed, 2);
+}
+
+TEST(SpeedTimelineTest, LooksUpSpeedAtMinute)
+{
+    SpeedTimeline timeline;
+    timeline.build(example_program_image());
+
+    EXPECT_EQ(timeline.speed_at(0), 2);
+    EXPECT_EQ(timeline.speed_at(359), 2);
+    EXPECT_EQ(timeline.speed_at(360), 3);
+    EXPECT_EQ(timeline.speed_at(1439), 0);
+    EXPECT_EQ(timeline.speed_at(1440), 2);
+    EXPECT_EQ(timeline.speed_at(WEEK_MINUTES - 1), 0);
+    EXPECT_EQ(timeline.speed_at(WEEK_MINUTES), 2); // Si riparte da lunedì
+}
+
+TEST(SpeedTimelineTest, TotalsMinutesPerSpeed)
+{
+    SpeedTimeline timeline;
+    timeline.build(example_program_image());
+
+    EXPECT_EQ(timeline.minutes_at_speed(0), 720 * 7);
+    EXPECT_EQ(timeline.minutes_at_speed(1), 0);
+    EXPECT_EQ(timeline.minutes_at_speed(2), 600 * 7);
+    EXPECT_EQ(timeline.minutes_at_speed(3), 120 * 7);
+    EXPECT_EQ(timeline.minutes_at_speed(7), 0); // Velocità non valida
+}
+
+TEST(SpeedTimelineTest, TotalsMinutesInRange)
+{
+    SpeedTimeline timeline;
+    timeline.build(example_program_image());
+
+    EXPECT_EQ(timeline.minutes_at_speed(3, 0, 1440), 120);
+    EXPECT_EQ(timeline.minutes_at_speed(3, 0, 370), 10);
+    EXPECT_EQ(timeline.minutes_at_speed(2, 1000, 1100), 80);
+    EXPECT_EQ(timeline.minutes_at_speed(0, 1260, 1500), 180); // Attraversa la mezzanotte
+    EXPECT_EQ(timeline.minutes_at_speed(0, 9000, 20000), timeline.minutes_at_speed(0, 9000, WEEK_MINUTES));
+    EXPECT_EQ(timeline.minutes_at_speed(3, 500, 400), 0);
+}
+
+TEST(SpeedTimelineTest, MergesRunsAcrossMidnight)
+{
+    SpeedTimeline timeline;
+    ASSERT_TRUE(timeline.build(build_program_image({0x173B, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B},
+                                                   {1, 1, 1, 1, 1, 1, 1, 1, 1})));
+
+    ASSERT_EQ(timeline.runs().size(), 1u);
+    EXPECT_EQ(timeline.speed_at(5000), 1);
+    EXPECT_EQ(timeline.minutes_at_speed(1), WEEK_MINUTES);
+    EXPECT_EQ(timeline.to_json(), "[[0,1]]");
+}
+
+TEST(SpeedTimelineTest, KeepsRealTransitionAt2359)
+{
+    SpeedTimeline timeline;
+    ASSERT_TRUE(timeline.build(build_program_image({0x173B, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B, 0x173B},
+                                                   {1, 2, 2, 2, 2, 2, 2, 2, 2})));
+
+    EXPECT_EQ(timeline.runs().size(), 14u);
+    EXPECT_EQ(timeline.speed_at(1439), 2);
+    EXPECT_EQ(timeline.minutes_at_speed(2), 7);
+}
+
+TEST(SpeedTimelineTest, FullProgramFitsIn63Runs)
+{
+    SpeedTimeline timeline;
+    ASSERT_TRUE(timeline.build(build_program_image({0x0100, 0x0200, 0x0300, 0x0400, 0x0500, 0x0600, 0x0700, 0x0800},
+                                                   {0, 1, 2, 1, 2, 1, 2, 1, 2})));
+
+    EXPECT_EQ(timeline.runs().size(), SPEED_TIMELINE_MAX_RUNS);
+    EXPECT_EQ(timeline.to_bytes().size(), SPEED_TIMELINE_MAX_RUNS * 3);
+    EXPECT_EQ(timeline.to_bytes()[3 * 62 + 1], (6 * 1440 + 480) & 0xFF);
+}
+
+TEST(SpeedTimelineTest, RejectsInvalidImage)
+{
+    SpeedTimeline timeline;
+    std::vector<uint8_t> image = example_program_image();
+    image[0] = 25; // 25:00
+
+    EXPECT_FALSE(timeline.build(image));
+    EXPECT_FALSE(timeline.valid());
+    EXPECT_FALSE(timeline.build(std::vector<uint8_t>(100, 0)));
+}
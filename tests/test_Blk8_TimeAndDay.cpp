@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/Blk8_TimeAndDay.h"
+
+// ============================================================================
+// HELPER: orologio della VMC simulato con deriva costante
+// ============================================================================
+
+static const uint32_t MS_PER_HOUR = 3600000UL;
+
+// Registri 0x0800/0x0801 di una VMC che al minuto della settimana locale
+// local_minute mostra local_minute - offset (minuto troncato)
+static void vmc_registers_for(float local_minute, float offset, uint16_t &hour_minute, uint16_t &weekday)
+{
+    float vmc = std::fmod(local_minute - offset + CLOCK_WEEK_MINUTES, (float)CLOCK_WEEK_MINUTES);
+    int32_t minute = (int32_t)std::floor(vmc);
+    weekday = minute / 1440 + 1;
+    hour_minute = (((minute % 1440) / 60) << 8) | (minute % 60);
+}
+
+// Un campione ogni mezz'ora (a secondi sparsi, come le letture reali) per hours ore,
+// con la VMC che perde drift_per_day minuti al giorno
+static void feed_drift(VmcClockSync &sync, uint32_t from_ms, uint32_t hours, float start_offset, float drift_per_day)
+{
+    for (uint32_t slot = 0; slot <= hours * 2; slot++)
+    {
+        uint32_t t = from_ms + slot * (MS_PER_HOUR / 2) + (slot * 37 % 60) * 1000;
+        float offset = start_offset + drift_per_day * (t - from_ms) / (float)CLOCK_MS_PER_DAY;
+        float local = 2000.0f + t / 60000.0f;
+        uint16_t hour_minute, weekday;
+        vmc_registers_for(local, offset, hour_minute, weekday);
+        sync.add_sample(hour_minute, weekday, local, t);
+    }
+}
+
+// ============================================================================
+// TEST: minuto della settimana e differenza modulare
+// ============================================================================
+
+TEST(VmcClockTest, MinuteOfWeekFromRegisters)
+{
+    EXPECT_EQ(vmc_clock_minute_of_week(0x0000, 1), 0);
+    EXPECT_EQ(vmc_clock_minute_of_week(0x0A1E, 2), 1440 + 630);
+    EXPECT_EQ(vmc_clock_minute_of_week(0x173B, 7), CLOCK_WEEK_MINUTES - 1);
+
+    EXPECT_EQ(vmc_clock_minute_of_week(0x1800, 1), -1); // 24:00
+    EXPECT_EQ(vmc_clock_minute_of_week(0x0A3C, 1), -1); // 10:60
+    EXPECT_EQ(vmc_clock_minute_of_week(0x0A00, 0), -1);
+    EXPECT_EQ(vmc_clock_minute_of_week(0x0A00, 8), -1);
+}
+
+TEST(VmcClockTest, OffsetWrapsAroundMidnightAndWeek)
+{
+    // Locale 00:00 di lunedì, VMC 23:59 di domenica: un minuto, non una settimana
+    EXPECT_FLOAT_EQ(clock_offset_minutes(0.0f, CLOCK_WEEK_MINUTES - 1), 1.0f);
+    EXPECT_FLOAT_EQ(clock_offset_minutes(CLOCK_WEEK_MINUTES - 1, 0), -1.0f);
+
+    // Mezzanotte tra martedì e mercoledì
+    EXPECT_FLOAT_EQ(clock_offset_minutes(2 * 1440 + 1, 2 * 1440 - 2), 3.0f);
+    EXPECT_FLOAT_EQ(clock_offset_minutes(1440 + 600, 1440 + 600), 0.0f);
+}
+
+// ============================================================================
+// TEST: quando scrivere
+// ============================================================================
+
+TEST(VmcClockTest, NoCorrectionWithinThreshold)
+{
+    VmcClockSync sync(2.0f, 1800000, 6, 6 * MS_PER_HOUR);
+
+    // VMC allineata (mostra il minuto troncato) per un giorno intero
+    feed_drift(sync, 0, 24, 0.0f, 0.0f);
+
+    EXPECT_FALSE(sync.correction_due(24 * MS_PER_HOUR));
+    EXPECT_TRUE(sync.estimate_ready());
+    EXPECT_NEAR(sync.drift_minutes_per_day(), 0.0f, 0.25f);
+    EXPECT_EQ(sync.corrections(), 0u);
+}
+
+TEST(VmcClockTest, LargeOffsetIsCorrectedImmediately)
+{
+    VmcClockSync sync;
+
+    // VMC mai impostata: 00:00 di lunedì, locale giovedì 18:40
+    float local = 3 * 1440 + 18 * 60 + 40;
+    sync.add_sample(0x0000, 1, local, 0);
+
+    EXPECT_TRUE(sync.correction_due(0));
+    EXPECT_EQ(sync.ms_until_correction(0), 0);
+    EXPECT_FALSE(sync.estimate_ready());
+}
+
+TEST(VmcClockTest, InvalidRegistersAreCorrectedImmediately)
+{
+    VmcClockSync sync;
+
+    EXPECT_FALSE(sync.add_sample(0x1900, 3, 100.0f, 0));
+    EXPECT_TRUE(sync.correction_due(0));
+}
+
+TEST(VmcClockTest, OneMinuteResolutionDoesNotTriggerWrites)
+{
+    VmcClockSync sync;
+
+    // Locale 10:00:50, VMC 10:00: offset misurato 0.33, mai oltre la soglia
+    for (uint32_t i = 0; i < 20; i++)
+        sync.add_sample(0x0A00, 1, 600.0f + 50.0f / 60.0f, i * 1800000UL);
+
+    EXPECT_FALSE(sync.correction_due(20 * 1800000UL));
+}
+
+// ============================================================================
+// TEST: stima della deriva
+// ============================================================================
+
+TEST(VmcClockTest, EstimatesDriftAndSchedulesCrossing)
+{
+    VmcClockSync sync(4.0f, 1800000, 6, 6 * MS_PER_HOUR);
+
+    // La VMC perde 2 minuti al giorno: dopo 36 ore è indietro di 3 minuti
+    feed_drift(sync, 0, 36, 0.0f, 2.0f);
+
+    ASSERT_TRUE(sync.estimate_ready());
+    EXPECT_NEAR(sync.drift_minutes_per_day(), 2.0f, 0.3f);
+    EXPECT_FALSE(sync.correction_due(36 * MS_PER_HOUR));
+
+    // Soglia di 4 minuti raggiunta circa 12 ore dopo
+    int32_t ms = sync.ms_until_correction(36 * MS_PER_HOUR);
+    ASSERT_GT(ms, 0);
+    EXPECT_NEAR(ms / (float)MS_PER_HOUR, 12.0f, 6.0f);
+}
+
+TEST(VmcClockTest, ArmsCorrectionTimerOnlyWhenMomentMoves)
+{
+    VmcClockSync sync(4.0f, 1800000, 6, 6 * MS_PER_HOUR);
+    feed_drift(sync, 0, 36, 0.0f, 2.0f);
+    uint32_t now = 36 * MS_PER_HOUR;
+
+    int32_t delay_ms;
+    ASSERT_TRUE(sync.schedule(now, delay_ms));
+    EXPECT_GT(delay_ms, 0);
+    uint32_t deadline = now + delay_ms;
+
+    // Letture successive con la stessa previsione: il timer armato resta valido
+    EXPECT_FALSE(sync.schedule(now + 30000, delay_ms));
+    EXPECT_NEAR((float)(now + 30000 + delay_ms), (float)deadline, 60000.0f);
+
+    // Timer scattato senza scrittura (la misura non conferma ancora la retta):
+    // nulla da armare né da fermare
+    uint32_t later = deadline + 120000;
+    EXPECT_FALSE(sync.schedule(later, delay_ms));
+    EXPECT_EQ(delay_ms, -1);
+
+    // La misura arriva oltre la soglia: timer riarmato per subito
+    float local = 2000.0f + later / 60000.0f;
+    uint16_t hour_minute, weekday;
+    vmc_registers_for(local, 4.5f, hour_minute, weekday);
+    sync.add_sample(hour_minute, weekday, local, later);
+    EXPECT_TRUE(sync.schedule(later, delay_ms));
+    EXPECT_EQ(delay_ms, 0);
+
+    // Dopo la correzione non c'è più nulla di armato
+    sync.on_correction_written(later);
+    EXPECT_FALSE(sync.schedule(later + 30000, delay_ms));
+    EXPECT_EQ(delay_ms, -1);
+}
+
+TEST(VmcClockTest, PredictedCrossingNeedsMeasuredConfirmation)
+{
+    VmcClockSync sync(2.0f, 1800000, 6, 6 * MS_PER_HOUR);
+    feed_drift(sync, 0, 12, 0.0f, 1.0f);
+
+    // La retta è già oltre la soglia, la misura (0.5 min) non lo conferma ancora
+    EXPECT_FALSE(sync.correction_due(5 * 24 * MS_PER_HOUR));
+
+    // Con la misura a 1.5 minuti basta la previsione
+    feed_drift(sync, 12 * MS_PER_HOUR + 1800000, 24, 0.5f, 1.0f);
+    EXPECT_TRUE(sync.correction_due(60 * MS_PER_HOUR));
+}
+
+TEST(VmcClockTest, SingleCorrectionWhenDriftCrossesThreshold)
+{
+    VmcClockSync sync(2.0f, 1800000, 6, 6 * MS_PER_HOUR);
+    uint32_t writes = 0;
+
+    // Una settimana con una VMC che perde 1 minuto al giorno, controllo ogni mezz'ora
+    float offset = 0.0f;
+    for (uint32_t t = 0; t < 7 * 24 * MS_PER_HOUR; t += MS_PER_HOUR / 2)
+    {
+        float local = t / 60000.0f;
+        uint16_t hour_minute, weekday;
+        vmc_registers_for(local, offset, hour_minute, weekday);
+        sync.add_sample(hour_minute, weekday, local, t);
+        if (sync.correction_due(t))
+        {
+            sync.on_correction_written(t);
+            offset = 0.0f; // La VMC riparte allineata
+            writes++;
+        }
+        offset += 1.0f / 48.0f;
+    }
+
+    // Una scrittura ogni ~2 giorni invece di una ogni ora
+    EXPECT_GE(writes, 2u);
+    EXPECT_LE(writes, 4u);
+    EXPECT_EQ(sync.corrections(), writes);
+}
+
+// ============================================================================
+// TEST: dopo la scrittura
+// ============================================================================
+
+TEST(VmcClockTest, SamplesIgnoredWhileWriteSettles)
+{
+    VmcClockSync sync;
+    sync.add_sample(0x0000, 1, 3000.0f, 0);
+    ASSERT_TRUE(sync.correction_due(0));
+    sync.on_correction_written(1000);
+
+    // Lettura partita prima della scrittura: ancora l'orologio vecchio
+    EXPECT_FALSE(sync.add_sample(0x0000, 1, 3000.0f, 2000));
+    EXPECT_FALSE(sync.correction_due(2000));
+    EXPECT_TRUE(std::isnan(sync.last_offset()));
+
+    EXPECT_TRUE(sync.add_sample(0x0202, 3, 3002.5f, 1000 + CLOCK_WRITE_SETTLE_MS));
+    EXPECT_FALSE(sync.correction_due(1000 + CLOCK_WRITE_SETTLE_MS));
+}
+
+TEST(VmcClockTest, DriftSurvivesCorrection)
+{
+    VmcClockSync sync(2.0f, 1800000, 6, 6 * MS_PER_HOUR);
+    feed_drift(sync, 0, 12, 0.0f, 1.0f);
+    float drift = sync.drift_minutes_per_day();
+    sync.on_correction_written(12 * MS_PER_HOUR);
+
+    // Il primo campione dopo la correzione riusa la pendenza stimata
+    feed_drift(sync, 13 * MS_PER_HOUR, 0, 0.0f, 1.0f);
+    ASSERT_TRUE(sync.estimate_ready());
+    EXPECT_FLOAT_EQ(sync.drift_minutes_per_day(), drift);
+    EXPECT_GT(sync.ms_until_correction(13 * MS_PER_HOUR), 0);
+}
+
+TEST(VmcClockTest, ClockJumpResetsEstimate)
+{
+    VmcClockSync sync(2.0f, 1800000, 6, 6 * MS_PER_HOUR);
+    feed_drift(sync, 0, 12, 0.0f, 0.0f);
+    ASSERT_TRUE(sync.estimate_ready());
+
+    // Orologio della VMC spostato a mano di 10 minuti
+    feed_drift(sync, 13 * MS_PER_HOUR, 0, 10.0f, 0.0f);
+
+    EXPECT_FALSE(sync.estimate_ready());
+    EXPECT_TRUE(sync.correction_due(13 * MS_PER_HOUR));
+}
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <map>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/alarm_journal.h"
+
+// ============================================================================
+// HELPER: flash simulata, sopravvive al "riavvio" del giornale
+// ============================================================================
+
+class MemoryStorage : public AlarmJournalStorage
+{
+public:
+    std::map<size_t, AlarmJournalPage> pages;
+    std::map<size_t, int> writes; // Scritture per pagina
+    bool fail = false;
+
+    bool load(size_t page, AlarmJournalPage &data) override
+    {
+        if (pages.count(page) == 0)
+            return false;
+        data = pages[page];
+        return true;
+    }
+
+    bool save(size_t page, const AlarmJournalPage &data) override
+    {
+        if (fail)
+            return false;
+        pages[page] = data;
+        writes[page]++;
+        return true;
+    }
+};
+
+// Alterna due parole di allarme: ogni chiamata è un evento
+static void toggle(AlarmJournal &journal, int events, uint32_t now_ms, uint32_t hours = 100)
+{
+    for (int i = 0; i < events; i++)
+    {
+        std::vector<AlarmEvent> recorded = journal.events();
+        uint16_t word = !recorded.empty() && recorded.back().after == 0x0200 ? 0x0000 : 0x0200;
+        journal.on_alarm_word(word, 1700000000 + i, hours, now_ms);
+    }
+}
+
+// ============================================================================
+// TEST: registrazione degli eventi
+// ============================================================================
+
+TEST(AlarmJournalTest, RecordsOnlyChangesOfTheAlarmWord)
+{
+    MemoryStorage storage;
+    AlarmJournal journal;
+    journal.restore(&storage);
+
+    EXPECT_FALSE(journal.on_alarm_word(0x0000, 1000, 10, 0)); // Nessun allarme dall'avvio
+    EXPECT_TRUE(journal.on_alarm_word(0x0040, 2000, 11, 0));  // Antigelo
+    EXPECT_FALSE(journal.on_alarm_word(0x0040, 2100, 11, 0));
+    EXPECT_TRUE(journal.on_alarm_word(0x0000, 3000, 12, 0));
+
+    std::vector<AlarmEvent> events = journal.events();
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].timestamp, 2000u);
+    EXPECT_EQ(events[0].before, 0x0000);
+    EXPECT_EQ(events[0].after, 0x0040);
+    EXPECT_EQ(events[0].hours, 11u);
+    EXPECT_EQ(events[1].before, 0x0040);
+    EXPECT_EQ(events[1].after, 0x0000);
+    EXPECT_EQ(journal.to_json(10), "[[2000,0,64,11],[3000,64,0,12]]");
+    EXPECT_EQ(journal.to_json(1), "[[3000,64,0,12]]");
+}
+
+TEST(AlarmJournalTest, IgnoresReadsBeforeRestore)
+{
+    AlarmJournal journal;
+
+    EXPECT_FALSE(journal.on_alarm_word(0x0040, 1000, 10, 0));
+    EXPECT_TRUE(journal.events().empty());
+}
+
+// ============================================================================
+// TEST: scritture in flash
+// ============================================================================
+
+TEST(AlarmJournalTest, KeepsPartialBatchInRamUntilDelay)
+{
+    MemoryStorage storage;
+    AlarmJournal journal(600000, 3600000);
+    journal.restore(&storage);
+
+    toggle(journal, 3, 1000);
+    EXPECT_FALSE(journal.flush_due(1000 + 3599999));
+    EXPECT_TRUE(storage.pages.empty());
+
+    ASSERT_TRUE(journal.flush_due(1000 + 3600000));
+    ASSERT_TRUE(journal.flush(1000 + 3600000));
+    EXPECT_EQ(journal.page_writes(), 1u);
+    EXPECT_EQ(storage.pages[0].count, 3);
+    EXPECT_EQ(journal.pending(), 0u);
+}
+
+TEST(AlarmJournalTest, FlappingAlarmIsRateLimited)
+{
+    MemoryStorage storage;
+    AlarmJournal journal(600000, 3600000);
+    journal.restore(&storage);
+
+    // Pagina piena: prima scrittura immediata
+    toggle(journal, ALARM_JOURNAL_PAGE_EVENTS, 0);
+    ASSERT_TRUE(journal.flush_due(0));
+    journal.flush(0);
+
+    // Un'altra pagina piena subito dopo deve aspettare l'intervallo minimo
+    toggle(journal, ALARM_JOURNAL_PAGE_EVENTS, 10000);
+    EXPECT_FALSE(journal.flush_due(10000));
+    EXPECT_TRUE(journal.flush_due(600000));
+
+    // Oltre il batch massimo in RAM si perdono gli eventi più vecchi
+    toggle(journal, ALARM_JOURNAL_MAX_PENDING, 20000);
+    EXPECT_EQ(journal.pending(), ALARM_JOURNAL_MAX_PENDING);
+    EXPECT_EQ(journal.dropped(), (uint32_t)ALARM_JOURNAL_PAGE_EVENTS);
+
+    journal.flush(600000);
+    EXPECT_EQ(journal.page_writes(), 1u + ALARM_JOURNAL_MAX_PENDING / ALARM_JOURNAL_PAGE_EVENTS);
+}
+
+TEST(AlarmJournalTest, WritesAreSpreadOverAllPages)
+{
+    MemoryStorage storage;
+    AlarmJournal journal(0, 0);
+    journal.restore(&storage);
+
+    for (size_t i = 0; i < 3 * ALARM_JOURNAL_PAGES; i++)
+    {
+        toggle(journal, 1, i);
+        journal.flush(i);
+    }
+
+    ASSERT_EQ(storage.writes.size(), ALARM_JOURNAL_PAGES);
+    for (size_t page = 0; page < ALARM_JOURNAL_PAGES; page++)
+        EXPECT_EQ(storage.writes[page], 3);
+    // Dimensione limitata: restano solo le ultime ALARM_JOURNAL_PAGES pagine
+    EXPECT_EQ(journal.events().size(), ALARM_JOURNAL_PAGES);
+}
+
+TEST(AlarmJournalTest, FailedWriteKeepsEventsInRam)
+{
+    MemoryStorage storage;
+    AlarmJournal journal;
+    journal.restore(&storage);
+    toggle(journal, 2, 0);
+
+    storage.fail = true;
+    EXPECT_FALSE(journal.flush(0));
+    EXPECT_EQ(journal.pending(), 2u);
+
+    storage.fail = false;
+    EXPECT_TRUE(journal.flush(0));
+    EXPECT_EQ(journal.pending(), 0u);
+}
+
+// ============================================================================
+// TEST: riavvio
+// ============================================================================
+
+TEST(AlarmJournalTest, RestoresHistoryInOrderAfterReboot)
+{
+    MemoryStorage storage;
+    {
+        AlarmJournal journal(0, 0);
+        journal.restore(&storage);
+        // Anello già girato: la pagina più recente non è l'ultima
+        for (size_t i = 0; i < ALARM_JOURNAL_PAGES + 3; i++)
+        {
+            journal.on_alarm_word(i % 2 ? 0x0000 : 0x0400, 1000 + i, i, 0);
+            journal.flush(0);
+        }
+    }
+
+    AlarmJournal rebooted(0, 0);
+    EXPECT_EQ(rebooted.restore(&storage), ALARM_JOURNAL_PAGES);
+    std::vector<AlarmEvent> events = rebooted.events();
+    ASSERT_EQ(events.size(), ALARM_JOURNAL_PAGES);
+    EXPECT_EQ(events.front().timestamp, 1003u);
+    EXPECT_EQ(events.back().timestamp, 1000u + ALARM_JOURNAL_PAGES + 2);
+
+    // Allarme ancora attivo al riavvio: nessun evento duplicato
+    uint16_t last = events.back().after;
+    EXPECT_FALSE(rebooted.on_alarm_word(last, 5000, 50, 0));
+    EXPECT_TRUE(rebooted.on_alarm_word(last ^ 0x0400, 5000, 50, 0));
+
+    // Le nuove pagine continuano dopo la più recente
+    rebooted.flush(0);
+    EXPECT_EQ(storage.writes[3], 2);
+}
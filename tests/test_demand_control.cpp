@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/demand_control.h"
+
+// ============================================================================
+// TEST: DeadbandForwarder (inoltro 0x30A / 0x30B)
+// ============================================================================
+
+TEST(DeadbandForwarderTest, WritesFirstSampleImmediately)
+{
+    DeadbandForwarder fwd(20, 30000);
+
+    EXPECT_TRUE(fwd.update(550, 0));
+    EXPECT_EQ(fwd.value(), 550);
+}
+
+TEST(DeadbandForwarderTest, IgnoresChangesInsideDeadband)
+{
+    DeadbandForwarder fwd(20, 30000);
+    fwd.update(550, 0);
+
+    EXPECT_FALSE(fwd.update(560, 60000));
+    EXPECT_FALSE(fwd.update(531, 120000));
+    EXPECT_EQ(fwd.writes(), 1u);
+}
+
+TEST(DeadbandForwarderTest, WritesChangesOutsideDeadband)
+{
+    DeadbandForwarder fwd(20, 30000);
+    fwd.update(550, 0);
+
+    EXPECT_TRUE(fwd.update(570, 60000));
+    EXPECT_EQ(fwd.value(), 570);
+}
+
+TEST(DeadbandForwarderTest, RateLimitKeepsLatestValuePending)
+{
+    DeadbandForwarder fwd(20, 30000);
+    fwd.update(550, 0);
+
+    EXPECT_FALSE(fwd.update(700, 5000));
+    EXPECT_FALSE(fwd.update(750, 10000));
+    EXPECT_FALSE(fwd.flush(20000));
+    EXPECT_TRUE(fwd.flush(30000));
+    EXPECT_EQ(fwd.value(), 750) << "Only the latest pending value is written";
+    EXPECT_EQ(fwd.writes(), 2u);
+}
+
+TEST(DeadbandForwarderTest, RefreshesUnchangedValuePeriodically)
+{
+    DeadbandForwarder fwd(20, 30000, 600000);
+    fwd.update(550, 0);
+
+    EXPECT_FALSE(fwd.flush(300000));
+    EXPECT_TRUE(fwd.flush(600000));
+    EXPECT_EQ(fwd.value(), 550);
+}
+
+TEST(DeadbandForwarderTest, InvalidateForcesRewrite)
+{
+    DeadbandForwarder fwd(20, 30000);
+    fwd.update(550, 0);
+    fwd.invalidate();
+
+    EXPECT_TRUE(fwd.update(551, 1000));
+}
+
+TEST(DeadbandForwarderTest, FlushWithoutSamplesDoesNothing)
+{
+    DeadbandForwarder fwd(20, 30000, 1000);
+
+    EXPECT_FALSE(fwd.flush(100000));
+}
+
+// ============================================================================
+// TEST: HysteresisLevel
+// ============================================================================
+
+TEST(HysteresisLevelTest, RisesOnThresholds)
+{
+    HysteresisLevel co2(800, 1000, 1300, 100);
+
+    EXPECT_EQ(co2.update(600), 0);
+    EXPECT_EQ(co2.update(800), 1);
+    EXPECT_EQ(co2.update(1400), 3);
+}
+
+TEST(HysteresisLevelTest, FallsOnlyBelowHysteresisBand)
+{
+    HysteresisLevel co2(800, 1000, 1300, 100);
+    co2.update(1050);
+    ASSERT_EQ(co2.level(), 2);
+
+    EXPECT_EQ(co2.update(950), 2) << "Inside hysteresis band";
+    EXPECT_EQ(co2.update(901), 2);
+    EXPECT_EQ(co2.update(899), 1);
+    EXPECT_EQ(co2.update(500), 0);
+}
+
+// ============================================================================
+// TEST: DemandSpeedController (velocità diretta 0x0309)
+// ============================================================================
+
+class DemandSpeedControllerTest : public ::testing::Test
+{
+protected:
+    DemandSpeedController controller{HysteresisLevel(800, 1000, 1300, 100),
+                                      HysteresisLevel(600, 700, 800, 50),
+                                      30000, 600000};
+};
+
+TEST_F(DemandSpeedControllerTest, NoWriteWithoutInputs)
+{
+    EXPECT_FALSE(controller.evaluate(0));
+}
+
+TEST_F(DemandSpeedControllerTest, UsesHighestDemand)
+{
+    controller.set_co2(850); // livello 1
+    controller.set_rh(750);  // livello 2
+
+    EXPECT_TRUE(controller.evaluate(0));
+    EXPECT_EQ(controller.speed(), 2);
+}
+
+TEST_F(DemandSpeedControllerTest, WritesOnlyOnSpeedChange)
+{
+    controller.set_co2(850);
+    ASSERT_TRUE(controller.evaluate(0));
+
+    controller.set_co2(900);
+    EXPECT_FALSE(controller.evaluate(60000));
+}
+
+TEST_F(DemandSpeedControllerTest, IncreasesQuicklyDecreasesSlowly)
+{
+    controller.set_co2(850);
+    ASSERT_TRUE(controller.evaluate(0));
+
+    controller.set_co2(1400);
+    EXPECT_FALSE(controller.evaluate(10000)) << "Rate limited";
+    EXPECT_TRUE(controller.evaluate(30000));
+    EXPECT_EQ(controller.speed(), 3);
+
+    controller.set_co2(400);
+    EXPECT_FALSE(controller.evaluate(60000));
+    EXPECT_FALSE(controller.evaluate(600000));
+    EXPECT_TRUE(controller.evaluate(630000));
+    EXPECT_EQ(controller.speed(), 0);
+}
+
+TEST_F(DemandSpeedControllerTest, InvalidateRewritesCurrentSpeed)
+{
+    controller.set_rh(650);
+    ASSERT_TRUE(controller.evaluate(0));
+    controller.invalidate();
+
+    EXPECT_TRUE(controller.evaluate(1000));
+    EXPECT_EQ(controller.speed(), 1);
+}
+
+// ============================================================================
+// TEST: ManualModeOverride
+// ============================================================================
+
+TEST(ManualModeOverrideTest, RestoresModeActiveBeforeDirectSpeed)
+{
+    ManualModeOverride mode_override;
+
+    EXPECT_TRUE(mode_override.enter(2)); // Program
+    EXPECT_FALSE(mode_override.enter(3)); // Già in velocità diretta
+    EXPECT_TRUE(mode_override.active());
+
+    EXPECT_TRUE(mode_override.leave(3));
+    EXPECT_EQ(mode_override.saved_mode(), 2);
+    EXPECT_FALSE(mode_override.active());
+    EXPECT_FALSE(mode_override.leave(3)); // Nessuna uscita senza entrata
+}
+
+TEST(ManualModeOverrideTest, KeepsModeChosenByUserMeanwhile)
+{
+    ManualModeOverride mode_override;
+
+    mode_override.enter(1); // Auto
+    EXPECT_FALSE(mode_override.leave(4)); // L'utente è passato a Party
+
+    mode_override.enter(1);
+    EXPECT_TRUE(mode_override.leave(1)); // Lettura ancora precedente a Manual
+}
+
+TEST(ManualModeOverrideTest, NothingToRestoreFromManualOrUnknown)
+{
+    ManualModeOverride mode_override;
+
+    EXPECT_TRUE(mode_override.enter(3)); // Era già Manual
+    EXPECT_FALSE(mode_override.leave(3));
+
+    EXPECT_TRUE(mode_override.enter(-1)); // Block 3 non ancora letto
+    EXPECT_FALSE(mode_override.leave(3));
+}
+
@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// Mock del ModbusController: memorizza le letture per rispondere dal test
+namespace modbus_controller
+{
+    enum class ModbusRegisterType : uint8_t
+    {
+        HOLDING = 3
+    };
+
+    typedef std::function<void(ModbusRegisterType, uint16_t, const std::vector<uint8_t> &)> ReadHandler;
+
+    class ModbusCommandItem
+    {
+    public:
+        uint16_t address = 0;
+        uint16_t count = 0;
+        ReadHandler handler;
+
+        static std::shared_ptr<ModbusCommandItem> create_read_command(
+            class ModbusController *controller, ModbusRegisterType register_type, uint16_t address, uint16_t count,
+            ReadHandler handler)
+        {
+            auto cmd = std::make_shared<ModbusCommandItem>();
+            cmd->address = address;
+            cmd->count = count;
+            cmd->handler = handler;
+            return cmd;
+        }
+    };
+
+    class ModbusController
+    {
+    public:
+        std::vector<std::shared_ptr<ModbusCommandItem>> queued;
+        void queue_command(std::shared_ptr<ModbusCommandItem> command) { queued.push_back(command); }
+
+        // Risponde al comando più vecchio con registri i = start + i
+        void respond()
+        {
+            auto cmd = queued.front();
+            queued.erase(queued.begin());
+            std::vector<uint8_t> data;
+            for (uint16_t i = 0; i < cmd->count; i++)
+            {
+                data.push_back((cmd->address + i) >> 8);
+                data.push_back((cmd->address + i) & 0xFF);
+            }
+            cmd->handler(ModbusRegisterType::HOLDING, cmd->address, data);
+        }
+    };
+}
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_arbiter.h"
+
+// ============================================================================
+// HELPER
+// ============================================================================
+
+struct CompletedRead
+{
+    bool ok;
+    uint16_t start;
+    std::vector<uint8_t> data;
+};
+
+class ModbusArbiterTest : public ::testing::Test
+{
+protected:
+    ModbusArbiter arbiter{30, 2000};
+    modbus_controller::ModbusController controller;
+    std::vector<CompletedRead> completed;
+
+    ModbusArbiter::ReadCallback record()
+    {
+        return [this](bool ok, uint16_t start, const std::vector<uint8_t> &data)
+        { completed.push_back({ok, start, data}); };
+    }
+
+    // Invia e risponde un frame; ritorna l'indirizzo letto (0xFFFF se nessun frame)
+    uint16_t step(uint32_t now_ms = 0, bool bus_busy = false)
+    {
+        if (!modbus_arbiter_dispatch(arbiter, &controller, now_ms, bus_busy))
+            return 0xFFFF;
+        uint16_t address = controller.queued.front()->address;
+        controller.respond();
+        return address;
+    }
+};
+
+// ============================================================================
+// TEST: priorità e suddivisione
+// ============================================================================
+
+TEST_F(ModbusArbiterTest, SplitsBulkReadsIntoChunks)
+{
+    arbiter.submit_read(BusPriority::BULK, 0x0400, 119, record());
+
+    EXPECT_EQ(step(), 0x0400);
+    EXPECT_EQ(controller.queued.size(), 0u);
+    EXPECT_EQ(step(), 0x041E);
+    EXPECT_EQ(step(), 0x043C);
+    EXPECT_TRUE(completed.empty());
+    EXPECT_EQ(step(), 0x045A);
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_TRUE(completed[0].ok);
+    EXPECT_EQ(completed[0].start, 0x0400);
+    ASSERT_EQ(completed[0].data.size(), 238u);
+    EXPECT_EQ(completed[0].data[236], 0x04); // 0x0476
+    EXPECT_EQ(completed[0].data[237], 0x76);
+    EXPECT_TRUE(arbiter.idle());
+}
+
+TEST_F(ModbusArbiterTest, StateReadsAreNeverSplit)
+{
+    arbiter.submit_read(BusPriority::STATE, 0x0200, 51, record());
+
+    step();
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_EQ(completed[0].data.size(), 102u);
+}
+
+TEST_F(ModbusArbiterTest, HigherClassesPreemptBulkBetweenChunks)
+{
+    arbiter.submit_read(BusPriority::BULK, 0x0400, 119, record());
+    EXPECT_EQ(step(), 0x0400);
+
+    // Polling, sorveglianza allarmi e rilettura di conferma arrivano a lettura massiva iniziata
+    arbiter.submit_read(BusPriority::STATE, 0x0100, 35, record());
+    arbiter.submit_read(BusPriority::ALARM, 0x0110, 1, record());
+    arbiter.submit_read(BusPriority::USER, 0x0300, 17, record());
+
+    EXPECT_EQ(step(), 0x0300);
+    EXPECT_EQ(step(), 0x0110);
+    EXPECT_EQ(step(), 0x0100);
+    EXPECT_EQ(step(), 0x041E); // La lettura massiva riprende da dove era rimasta
+    EXPECT_EQ(arbiter.preemptions(), 3u);
+}
+
+TEST_F(ModbusArbiterTest, UserCommandsOnControllerQueuesBlockEverything)
+{
+    arbiter.submit_read(BusPriority::BULK, 0x0400, 119, record());
+    EXPECT_EQ(step(), 0x0400);
+
+    // Scrittura utente accodata su un controller: nessun frame dell'arbitro
+    EXPECT_EQ(step(0, true), 0xFFFF);
+    EXPECT_EQ(step(100, true), 0xFFFF);
+    EXPECT_EQ(step(200, false), 0x041E);
+}
+
+TEST_F(ModbusArbiterTest, OneFrameInFlightAtATime)
+{
+    arbiter.submit_read(BusPriority::STATE, 0x0000, 14, record());
+    arbiter.submit_read(BusPriority::STATE, 0x0100, 35, record());
+
+    ASSERT_TRUE(modbus_arbiter_dispatch(arbiter, &controller, 0, false));
+    EXPECT_FALSE(modbus_arbiter_dispatch(arbiter, &controller, 10, false));
+    EXPECT_EQ(controller.queued.size(), 1u);
+
+    controller.respond();
+    EXPECT_TRUE(modbus_arbiter_dispatch(arbiter, &controller, 20, false));
+}
+
+TEST_F(ModbusArbiterTest, RejectsDuplicatesAndFullClasses)
+{
+    EXPECT_TRUE(arbiter.submit_read(BusPriority::STATE, 0x0100, 35, record()));
+    EXPECT_FALSE(arbiter.submit_read(BusPriority::STATE, 0x0100, 35, record()));
+    EXPECT_FALSE(arbiter.submit_read(BusPriority::STATE, 0x0100, 0, record()));
+
+    for (uint16_t i = 1; i < ModbusArbiter::MAX_QUEUED_PER_CLASS; i++)
+        EXPECT_TRUE(arbiter.submit_read(BusPriority::BULK, 0x0400 + i, 1, record()));
+    EXPECT_TRUE(arbiter.submit_read(BusPriority::BULK, 0x0400, 1, record()));
+    EXPECT_FALSE(arbiter.submit_read(BusPriority::BULK, 0x0500, 1, record()));
+}
+
+// ============================================================================
+// TEST: errori
+// ============================================================================
+
+TEST_F(ModbusArbiterTest, TimeoutDropsReadAndIgnoresLateResponse)
+{
+    arbiter.submit_read(BusPriority::BULK, 0x0400, 119, record());
+    arbiter.submit_read(BusPriority::STATE, 0x0300, 17, record());
+
+    ASSERT_TRUE(modbus_arbiter_dispatch(arbiter, &controller, 0, false)); // 0x0300
+    EXPECT_FALSE(modbus_arbiter_dispatch(arbiter, &controller, 1999, false));
+    ASSERT_TRUE(modbus_arbiter_dispatch(arbiter, &controller, 2000, false)); // 0x0400 dopo il timeout
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_FALSE(completed[0].ok);
+    EXPECT_EQ(arbiter.timeouts(), 1u);
+
+    // La risposta tardiva a 0x0300 non viene presa per quella di 0x0400
+    controller.respond();
+    EXPECT_EQ(completed.size(), 1u);
+    EXPECT_TRUE(arbiter.in_flight());
+    controller.respond();
+    EXPECT_FALSE(arbiter.in_flight());
+}
+
+TEST_F(ModbusArbiterTest, WrongSizeFailsWholeRead)
+{
+    arbiter.submit_read(BusPriority::BULK, 0x0400, 119, record());
+    step();
+    ASSERT_TRUE(modbus_arbiter_dispatch(arbiter, &controller, 0, false));
+
+    arbiter.on_response(arbiter.frame_id(), std::vector<uint8_t>(10, 0));
+
+    ASSERT_EQ(completed.size(), 1u);
+    EXPECT_FALSE(completed[0].ok);
+    EXPECT_TRUE(arbiter.idle());
+}
+
+TEST_F(ModbusArbiterTest, CallbackCanSubmitNewReads)
+{
+    arbiter.submit_read(BusPriority::STATE, 0x0000, 14,
+                        [this](bool ok, uint16_t start, const std::vector<uint8_t> &data)
+                        { arbiter.submit_read(BusPriority::STATE, 0x0000, 14, record()); });
+
+    step();
+    EXPECT_EQ(arbiter.queued(BusPriority::STATE), 1u);
+    step();
+    EXPECT_EQ(completed.size(), 1u);
+}
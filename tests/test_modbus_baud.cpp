@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_baud.h"
+
+// ============================================================================
+// SLAVE SIMULATO
+// ============================================================================
+
+// VMC sul bus: risponde solo se la UART del nodo è alla sua stessa velocità.
+// accepts_fast = false simula un firmware che ignora il bit MB Uart speed.
+// Il loop riproduce l'interval da 1s di modbus.yaml.
+class SimulatedVmc
+{
+public:
+    ModbusBaudManager baud{ModbusBaudManager(2000, 3000, 3)};
+    uint32_t vmc_baud = MODBUS_BAUD_SLOW;
+    uint16_t reg_0200 = 0x0004; // Flush mode attivo, da preservare
+    bool accepts_fast = true;
+    bool powered = true;
+    uint32_t now_ms = 0;
+    std::vector<uint32_t> applied;
+    int flag_writes = 0;
+
+    void run_for(uint32_t duration_ms)
+    {
+        uint32_t end = now_ms + duration_ms;
+        while (now_ms < end)
+        {
+            tick();
+            now_ms += 1000;
+        }
+    }
+
+    void tick()
+    {
+        switch (baud.next_action(now_ms))
+        {
+        case BaudAction::WRITE_FLAGS:
+            flag_writes++;
+            if (powered && baud.uart_baud() == vmc_baud)
+            {
+                reg_0200 = baud.flags_value();
+                if (accepts_fast)
+                    vmc_baud = (reg_0200 & MB_UART_SPEED_MASK) ? MODBUS_BAUD_FAST : MODBUS_BAUD_SLOW;
+            }
+            break;
+        case BaudAction::APPLY_BAUD:
+            applied.push_back(baud.uart_baud());
+            if (baud.busy() && powered && baud.uart_baud() == vmc_baud)
+                baud.on_probe_response();
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+// ============================================================================
+// TEST: send_wait_time derivato dalla velocità
+// ============================================================================
+
+TEST(ModbusSendWaitTest, MatchesHistoricalValueAt9600)
+{
+    EXPECT_EQ(modbus_send_wait_ms(9600), 310);
+}
+
+TEST(ModbusSendWaitTest, ShrinksWithFasterBaud)
+{
+    EXPECT_EQ(modbus_send_wait_ms(19200), 180);
+    EXPECT_EQ(modbus_send_wait_ms(38400), 110);
+    EXPECT_LT(modbus_send_wait_ms(38400), modbus_send_wait_ms(9600));
+}
+
+// ============================================================================
+// TEST: procedura di cambio velocità
+// ============================================================================
+
+TEST(ModbusBaudTest, UpgradesAndPreservesOtherFlags)
+{
+    SimulatedVmc vmc;
+    ASSERT_TRUE(vmc.baud.start_upgrade(vmc.reg_0200));
+    vmc.run_for(10000);
+
+    EXPECT_FALSE(vmc.baud.busy());
+    EXPECT_EQ(vmc.baud.result(), BaudUpgradeResult::UPGRADED);
+    EXPECT_EQ(vmc.baud.uart_baud(), MODBUS_BAUD_FAST);
+    EXPECT_EQ(vmc.reg_0200, 0x000C);
+    EXPECT_EQ(vmc.flag_writes, 1);
+    ASSERT_EQ(vmc.applied.size(), 1u);
+    EXPECT_EQ(vmc.applied[0], MODBUS_BAUD_FAST);
+}
+
+TEST(ModbusBaudTest, RevertsFlagWhenVmcStaysAt9600)
+{
+    SimulatedVmc vmc;
+    vmc.accepts_fast = false;
+    vmc.baud.start_upgrade(vmc.reg_0200);
+    vmc.run_for(30000);
+
+    EXPECT_FALSE(vmc.baud.busy());
+    EXPECT_EQ(vmc.baud.result(), BaudUpgradeResult::REJECTED);
+    EXPECT_EQ(vmc.baud.uart_baud(), MODBUS_BAUD_SLOW);
+    EXPECT_EQ(vmc.reg_0200, 0x0004);
+    EXPECT_EQ(vmc.flag_writes, 2);
+}
+
+TEST(ModbusBaudTest, FallsBackTo9600WithoutAnyAnswer)
+{
+    SimulatedVmc vmc;
+    vmc.baud.start_upgrade(vmc.reg_0200);
+    vmc.powered = false;
+    vmc.run_for(60000);
+
+    EXPECT_FALSE(vmc.baud.busy());
+    EXPECT_EQ(vmc.baud.result(), BaudUpgradeResult::NO_RESPONSE);
+    EXPECT_EQ(vmc.baud.uart_baud(), MODBUS_BAUD_SLOW);
+    EXPECT_EQ(vmc.applied.back(), MODBUS_BAUD_SLOW);
+    // 3 probe per velocità + ritorno finale a 9600
+    EXPECT_EQ(vmc.applied.size(), 7u);
+}
+
+TEST(ModbusBaudTest, DoesNothingWhenAlreadyFast)
+{
+    SimulatedVmc vmc;
+    vmc.baud.start_upgrade(vmc.reg_0200);
+    vmc.run_for(10000);
+    ASSERT_EQ(vmc.baud.uart_baud(), MODBUS_BAUD_FAST);
+
+    EXPECT_FALSE(vmc.baud.start_upgrade(vmc.reg_0200));
+    EXPECT_FALSE(vmc.baud.busy());
+}
+
+TEST(ModbusBaudTest, HuntAlternatesSpeedsWhenIdle)
+{
+    ModbusBaudManager baud;
+
+    EXPECT_EQ(baud.hunt_baud(), MODBUS_BAUD_FAST);
+    EXPECT_EQ(baud.hunt_baud(), MODBUS_BAUD_SLOW);
+    EXPECT_EQ(baud.hunt_baud(), MODBUS_BAUD_FAST);
+}
+
+TEST(ModbusBaudTest, IgnoresStrayProbeResponses)
+{
+    ModbusBaudManager baud;
+    baud.on_probe_response();
+
+    EXPECT_FALSE(baud.busy());
+    EXPECT_EQ(baud.result(), BaudUpgradeResult::NONE);
+    EXPECT_EQ(baud.uart_baud(), MODBUS_BAUD_SLOW);
+}
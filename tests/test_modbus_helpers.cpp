@@ -519,4 +519,85 @@ TEST(ModbusBitOrderComparisonTest, DISABLED_ComparesLSBandMSBOrders) {
     // MSB_FIRST: bit 0 dovrebbe essere 1 (MSB), bit 15 dovrebbe essere 1 (LSB)
     EXPECT_TRUE(msb_bit0);
     EXPECT_TRUE(msb_bit15);
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// TEST: modbusCrc16
+// ============================================================================
+
+TEST(ModbusCrc16Test, MatchesReadHoldingRegistersFrame) {
+    // 01 03 00 00 00 0A -> CRC trasmesso come C5 CD
+    std::vector<uint8_t> frame = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A};
+
+    EXPECT_EQ(modbusCrc16(frame, 0, frame.size()), 0xCDC5);
+}
+
+TEST(ModbusCrc16Test, MatchesStandardCheckValue) {
+    std::vector<uint8_t> data = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+    EXPECT_EQ(modbusCrc16(data, 0, data.size()), 0x4B37);
+}
+
+TEST(ModbusCrc16Test, ComputesFromOffsetAndClampsLength) {
+    std::vector<uint8_t> data = {0xAA, 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A};
+
+    EXPECT_EQ(modbusCrc16(data, 1, 6), 0xCDC5);
+    EXPECT_EQ(modbusCrc16(data, 1, 100), 0xCDC5);
+    EXPECT_EQ(modbusCrc16(data, 0, 0), 0xFFFF);
+}
+
+// ============================================================================
+// TEST: Fixed16 (virgola fissa)
+// ============================================================================
+
+TEST(ModbusFixed16Test, DecodesSignedRegisterBitExact) {
+    std::vector<uint8_t> data = {0x00, 0xD7, 0xFF, 0x85}; // 215, -123
+
+    EXPECT_EQ(Fixed16<1>::decode(data, 0).raw, 215);
+    EXPECT_EQ(Fixed16<1>::decode(data, 2).raw, -123);
+    EXPECT_FLOAT_EQ(Fixed16<1>::decode(data, 0).to_float(), 21.5f);
+    // Stesso risultato del decoder float
+    EXPECT_EQ(Fixed16<1>::decode(data, 2).to_float(), readSigned16ToFloat(data, 2, Scale::DECIMAL));
+}
+
+TEST(ModbusFixed16Test, DecodesCentesimalRegister) {
+    std::vector<uint8_t> data = {0x00, 0x96, 0xFF, 0xCE}; // 150, -50
+
+    EXPECT_FLOAT_EQ(Fixed16<2>::decode(data, 0).to_float(), 1.5f);
+    EXPECT_EQ(Fixed16<2>::decode(data, 2).to_float(), readSigned16ToFloat(data, 2, Scale::CENTESIMAL));
+}
+
+TEST(ModbusFixed16Test, ClampsInIntegerUnits) {
+    std::vector<uint8_t> data = {0x03, 0x84, 0xFE, 0x0C}; // 90.0, -50.0
+    Fixed16<1> min_value = Fixed16<1>::units(-40);
+    Fixed16<1> max_value = Fixed16<1>::units(85);
+
+    EXPECT_EQ(Fixed16<1>::decode(data, 0).clamp(min_value, max_value).raw, 850);
+    EXPECT_EQ(Fixed16<1>::decode(data, 2).clamp(min_value, max_value).raw, -400);
+    EXPECT_EQ(Fixed16<1>{215}.clamp(min_value, max_value).raw, 215);
+}
+
+TEST(ModbusFixed16Test, FormatsWithoutFloat) {
+    char text[12];
+
+    Fixed16<1>{215}.format(text, sizeof(text));
+    EXPECT_STREQ(text, "21.5");
+    Fixed16<1>{-5}.format(text, sizeof(text));
+    EXPECT_STREQ(text, "-0.5");
+    Fixed16<2>{-1205}.format(text, sizeof(text));
+    EXPECT_STREQ(text, "-12.05");
+    Fixed16<0>{42}.format(text, sizeof(text));
+    EXPECT_STREQ(text, "42");
+}
+
+TEST(ModbusFixed16Test, ChangeDetectionComparesExactValues) {
+    FixedChange<1> change;
+
+    EXPECT_TRUE(change.changed(Fixed16<1>{215}));
+    EXPECT_FALSE(change.changed(Fixed16<1>{215}));
+    EXPECT_TRUE(change.changed(Fixed16<1>{216}));
+    EXPECT_TRUE(change.changed(Fixed16<1>{215}));
+
+    change.reset();
+    EXPECT_TRUE(change.changed(Fixed16<1>{215}));
+}
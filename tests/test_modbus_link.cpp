@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_link.h"
+
+// ============================================================================
+// SLAVE SIMULATO
+// ============================================================================
+
+// Simula la VMC sul bus: se accesa risponde a tutti i blocchi e al probe,
+// altrimenti nessuna risposta (come un timeout del modbus_controller).
+// Il loop riproduce l'interval da 1s configurato in modbus.yaml.
+class SimulatedBus
+{
+public:
+    ModbusLinkMonitor link;
+    bool powered = true;
+    bool block2_garbled = false;
+    uint32_t now_ms = 0;
+    int polls = 0;
+    int probes = 0;
+
+    explicit SimulatedBus(const ModbusLinkMonitor &monitor) : link(monitor) {}
+
+    void run_for(uint32_t duration_ms)
+    {
+        uint32_t end = now_ms + duration_ms;
+        while (now_ms < end)
+        {
+            tick();
+            now_ms += 1000;
+        }
+    }
+
+    void tick()
+    {
+        switch (link.next_action(now_ms))
+        {
+        case LinkAction::POLL:
+            polls++;
+            if (powered)
+            {
+                for (uint8_t block = 0; block < LINK_BLOCK_COUNT; block++)
+                {
+                    bool ok = !(block == LINK_BLK2 && block2_garbled);
+                    link.on_block_result(block, ok, now_ms);
+                }
+            }
+            break;
+        case LinkAction::PROBE:
+            probes++;
+            if (powered)
+                link.on_probe_response(now_ms);
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+class ModbusLinkTest : public ::testing::Test
+{
+protected:
+    // soglia 3, polling 30s, timeout round 10s, backoff 5s..60s
+    SimulatedBus bus{ModbusLinkMonitor(3, 30000, 10000, 5000, 60000)};
+};
+
+// ============================================================================
+// TEST: polling con link attivo
+// ============================================================================
+
+TEST_F(ModbusLinkTest, PollsImmediatelyAndThenEveryInterval)
+{
+    bus.run_for(91000); // t = 0, 30, 60, 90 s
+
+    EXPECT_EQ(bus.polls, 4);
+    EXPECT_EQ(bus.probes, 0);
+    EXPECT_EQ(bus.link.state(), LinkState::ONLINE);
+}
+
+TEST_F(ModbusLinkTest, PartialRoundIsDegradedButNotAFailure)
+{
+    bus.block2_garbled = true;
+    bus.run_for(200000);
+
+    EXPECT_EQ(bus.link.state(), LinkState::DEGRADED);
+    EXPECT_TRUE(bus.link.is_online());
+    EXPECT_EQ(bus.link.consecutive_failures(), 0);
+    EXPECT_GT(bus.link.block_failures(LINK_BLK2), 1);
+    EXPECT_EQ(bus.link.block_failures(LINK_BLK1), 0);
+    EXPECT_EQ(bus.probes, 0);
+}
+
+TEST_F(ModbusLinkTest, GarbledBlockRecoversCounter)
+{
+    bus.block2_garbled = true;
+    bus.run_for(61000);
+    bus.block2_garbled = false;
+    bus.run_for(30000);
+
+    EXPECT_EQ(bus.link.block_failures(LINK_BLK2), 0);
+    EXPECT_EQ(bus.link.state(), LinkState::ONLINE);
+}
+
+// ============================================================================
+// TEST: circuit breaker
+// ============================================================================
+
+TEST_F(ModbusLinkTest, OpensCircuitAfterThresholdFailedRounds)
+{
+    bus.powered = false;
+    bus.run_for(61000); // 3 round falliti (0, 30, 60s), il terzo chiuso a 70s
+
+    EXPECT_EQ(bus.link.state(), LinkState::DEGRADED);
+    EXPECT_EQ(bus.link.consecutive_failures(), 2);
+
+    bus.run_for(10000);
+
+    EXPECT_EQ(bus.link.state(), LinkState::OFFLINE);
+    EXPECT_FALSE(bus.link.is_online());
+    EXPECT_EQ(bus.polls, 3);
+}
+
+TEST_F(ModbusLinkTest, OnlyProbesWhileOffline)
+{
+    bus.powered = false;
+    bus.run_for(600000);
+
+    // Dopo l'apertura del circuito nessun altro round completo
+    EXPECT_EQ(bus.polls, 3);
+    EXPECT_GT(bus.probes, 0);
+}
+
+TEST_F(ModbusLinkTest, BackoffGrowsExponentiallyUpToMax)
+{
+    bus.powered = false;
+    bus.run_for(71000);
+    ASSERT_EQ(bus.link.state(), LinkState::OFFLINE);
+    EXPECT_EQ(bus.link.current_backoff_ms(), 5000u);
+
+    std::vector<uint32_t> backoffs;
+    for (int i = 0; i < 600; i++)
+    {
+        uint32_t before = bus.link.current_backoff_ms();
+        bus.run_for(1000);
+        if (bus.link.current_backoff_ms() != before)
+            backoffs.push_back(bus.link.current_backoff_ms());
+    }
+
+    ASSERT_GE(backoffs.size(), 4u);
+    EXPECT_EQ(backoffs[0], 10000u);
+    EXPECT_EQ(backoffs[1], 20000u);
+    EXPECT_EQ(backoffs[2], 40000u);
+    EXPECT_EQ(backoffs[3], 60000u);
+    EXPECT_EQ(bus.link.current_backoff_ms(), 60000u);
+}
+
+TEST_F(ModbusLinkTest, IdleCostIsBoundedDuringLongOutage)
+{
+    bus.powered = false;
+    bus.run_for(3600000); // 1 ora di VMC spenta
+
+    // Con backoff massimo a 60s + 10s di timeout: circa un probe ogni 70s
+    EXPECT_LE(bus.probes, 3600 / 70 + 5);
+}
+
+TEST_F(ModbusLinkTest, RecoversQuicklyWhenSlaveAnswersAgain)
+{
+    bus.powered = false;
+    bus.run_for(600000);
+    ASSERT_EQ(bus.link.state(), LinkState::OFFLINE);
+    int polls_before = bus.polls;
+
+    bus.powered = true;
+    uint32_t restored_at = bus.now_ms;
+    while (bus.polls == polls_before && bus.now_ms - restored_at < 200000)
+        bus.run_for(1000);
+
+    // Al massimo un backoff (60s) + timeout del probe (10s) + un tick
+    EXPECT_LE(bus.now_ms - restored_at, 72000u);
+    EXPECT_EQ(bus.link.state(), LinkState::ONLINE);
+    EXPECT_EQ(bus.link.current_backoff_ms(), 5000u);
+}
+
+TEST_F(ModbusLinkTest, LateBlockResponseClosesCircuit)
+{
+    bus.powered = false;
+    bus.run_for(71000);
+    ASSERT_EQ(bus.link.state(), LinkState::OFFLINE);
+
+    bus.link.on_block_result(LINK_BLK1, true, bus.now_ms);
+
+    EXPECT_TRUE(bus.link.is_online());
+    EXPECT_EQ(bus.link.next_action(bus.now_ms), LinkAction::POLL);
+}
+
+TEST_F(ModbusLinkTest, ReportsStateChangeOnlyOnce)
+{
+    EXPECT_FALSE(bus.link.consume_state_change());
+
+    bus.powered = false;
+    bus.run_for(71000);
+
+    EXPECT_TRUE(bus.link.consume_state_change());
+    EXPECT_FALSE(bus.link.consume_state_change());
+}
+
+TEST(ModbusLinkMonitorTest, HandlesMillisOverflow)
+{
+    ModbusLinkMonitor link(3, 30000, 10000, 5000, 60000);
+    uint32_t start = 0xFFFFFFFF - 5000;
+
+    EXPECT_EQ(link.next_action(start), LinkAction::POLL);
+    for (uint8_t block = 0; block < LINK_BLOCK_COUNT; block++)
+        link.on_block_result(block, true, start);
+
+    EXPECT_EQ(link.next_action(start + 10000), LinkAction::NONE);
+    EXPECT_EQ(link.next_action(start + 30000), LinkAction::POLL);
+}
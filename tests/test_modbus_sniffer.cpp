@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_helpers.h"
+#include "../config/modbus_tcp_gateway.h"
+#include "../config/modbus_sniffer.h"
+
+// ============================================================================
+// HELPER: frame RTU come li vedrebbe la UART
+// ============================================================================
+
+static std::vector<uint8_t> with_crc(std::vector<uint8_t> frame)
+{
+    uint16_t crc = modbusCrc16(frame, 0, frame.size());
+    frame.push_back(crc & 0xFF);
+    frame.push_back(crc >> 8);
+    return frame;
+}
+
+static std::vector<uint8_t> read_request(uint16_t start, uint16_t count, uint8_t slave = 1)
+{
+    return with_crc({slave, 0x03, (uint8_t)(start >> 8), (uint8_t)(start & 0xFF), (uint8_t)(count >> 8), (uint8_t)(count & 0xFF)});
+}
+
+// Risposta con registro i = first + i
+static std::vector<uint8_t> read_response(uint16_t count, uint16_t first, uint8_t slave = 1)
+{
+    std::vector<uint8_t> frame = {slave, 0x03, (uint8_t)(count * 2)};
+    for (uint16_t i = 0; i < count; i++)
+    {
+        frame.push_back((first + i) >> 8);
+        frame.push_back((first + i) & 0xFF);
+    }
+    return with_crc(frame);
+}
+
+static std::vector<uint8_t> concat(const std::vector<std::vector<uint8_t>> &frames)
+{
+    std::vector<uint8_t> stream;
+    for (const auto &frame : frames)
+        stream.insert(stream.end(), frame.begin(), frame.end());
+    return stream;
+}
+
+// ============================================================================
+// TEST: abbinamento richiesta/risposta
+// ============================================================================
+
+TEST(ModbusSnifferTest, DecodesPanelReadOfWholeBlock)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+
+    sniffer.feed(read_request(0x0100, 35), 0, reads);
+    EXPECT_TRUE(reads.empty());
+    EXPECT_EQ(sniffer.feed(read_response(35, 0x0100), 30, reads), 1u);
+
+    ASSERT_EQ(reads.size(), 1u);
+    EXPECT_EQ(reads[0].start, 0x0100);
+    ASSERT_EQ(reads[0].data.size(), 70u);
+    EXPECT_EQ(reads[0].data[0], 0x01);
+    EXPECT_EQ(reads[0].data[69], 0x22);
+    EXPECT_EQ(sniffer.frames(), 2u);
+}
+
+TEST(ModbusSnifferTest, SlicesReadsSpanningSeveralBlocks)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+
+    // 0x0800-0x0801 contiene tutto il Block 8
+    sniffer.feed(concat({read_request(0x0800, 2), read_response(2, 0x0A1E)}), 0, reads);
+
+    ASSERT_EQ(reads.size(), 1u);
+    EXPECT_EQ(reads[0].start, 0x0800);
+    EXPECT_EQ(reads[0].data, (std::vector<uint8_t>{0x0A, 0x1E, 0x0A, 0x1F}));
+}
+
+TEST(ModbusSnifferTest, IgnoresPartialBlockReads)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+
+    // Il pannello legge solo 0x0300-0x0309: i decoder vogliono il blocco intero
+    sniffer.feed(concat({read_request(0x0300, 10), read_response(10, 0)}), 0, reads);
+
+    EXPECT_TRUE(reads.empty());
+    EXPECT_FALSE(sniffer.observed(0x0300, 17, 0, VMC_SNIFFER_MAX_AGE_MS));
+}
+
+TEST(ModbusSnifferTest, IgnoresResponsesToOwnRequests)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+
+    // Il nostro frame esce in TX, nella RX si vede solo la risposta
+    sniffer.on_own_request();
+    sniffer.feed(read_response(17, 0), 0, reads);
+    EXPECT_TRUE(reads.empty());
+
+    // Una risposta senza richiesta vista non è attribuibile
+    sniffer.feed(read_response(17, 0), 100, reads);
+    EXPECT_TRUE(reads.empty());
+}
+
+TEST(ModbusSnifferTest, IgnoresOtherSlavesAndMismatchedCounts)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+
+    sniffer.feed(concat({read_request(0x0300, 17, 2), read_response(17, 0, 2)}), 0, reads);
+    sniffer.feed(concat({read_request(0x0300, 17), read_response(16, 0)}), 100, reads);
+
+    EXPECT_TRUE(reads.empty());
+    EXPECT_EQ(sniffer.frames(), 4u);
+}
+
+// ============================================================================
+// TEST: framing e CRC
+// ============================================================================
+
+TEST(ModbusSnifferTest, RejectsCorruptedFrames)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+    std::vector<uint8_t> response = read_response(17, 0);
+    response[10] ^= 0x01;
+
+    sniffer.feed(read_request(0x0300, 17), 0, reads);
+    sniffer.feed(response, 20, reads);
+
+    EXPECT_TRUE(reads.empty());
+    EXPECT_GT(sniffer.dropped_bytes(), 0u);
+}
+
+TEST(ModbusSnifferTest, ResynchronizesAfterNoise)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+
+    // Rumore, scrittura del pannello ed eco, poi una lettura valida
+    std::vector<uint8_t> stream = {0x00, 0xFF, 0x13};
+    std::vector<uint8_t> write = with_crc({0x01, 0x06, 0x03, 0x07, 0x00, 0x02});
+    std::vector<uint8_t> tail = concat({write, write, read_request(0x0000, 14), read_response(14, 0x0100)});
+    stream.insert(stream.end(), tail.begin(), tail.end());
+
+    sniffer.feed(stream, 0, reads);
+
+    ASSERT_EQ(reads.size(), 1u);
+    EXPECT_EQ(reads[0].start, 0x0000);
+    EXPECT_EQ(sniffer.dropped_bytes(), 3u);
+}
+
+TEST(ModbusSnifferTest, ReplaysCaptureSplitInArbitraryChunks)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+    std::vector<uint8_t> capture = concat({read_request(0x0400, 119), read_response(119, 0x0600),
+                                           read_request(0x0200, 51), read_response(51, 0)});
+
+    // Blocchi di 7 byte consegnati a 1 ms di distanza (sotto il gap di fine frame)
+    for (size_t offset = 0; offset < capture.size(); offset += 7)
+    {
+        size_t end = std::min(capture.size(), offset + 7);
+        sniffer.feed(std::vector<uint8_t>(capture.begin() + offset, capture.begin() + end), offset / 7, reads);
+    }
+
+    ASSERT_EQ(reads.size(), 2u);
+    EXPECT_EQ(reads[0].start, 0x0400);
+    EXPECT_EQ(reads[0].data.size(), 238u);
+    EXPECT_EQ(reads[1].start, 0x0200);
+    EXPECT_EQ(sniffer.decoded_blocks(), 2u);
+}
+
+TEST(ModbusSnifferTest, DropsTruncatedFrameAfterSilence)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+    std::vector<uint8_t> request = read_request(0x0300, 17);
+
+    sniffer.feed(std::vector<uint8_t>(request.begin(), request.begin() + 5), 0, reads);
+    sniffer.feed(concat({read_request(0x0300, 17), read_response(17, 0)}), 100, reads);
+
+    EXPECT_EQ(reads.size(), 1u);
+    EXPECT_EQ(sniffer.dropped_bytes(), 5u);
+}
+
+// ============================================================================
+// TEST: freschezza per il polling
+// ============================================================================
+
+TEST(ModbusSnifferTest, ObservedBlocksExpire)
+{
+    ModbusRtuSniffer sniffer;
+    std::vector<SniffedRead> reads;
+    sniffer.feed(concat({read_request(0x0100, 35), read_response(35, 0)}), 1000, reads);
+
+    EXPECT_TRUE(sniffer.observed(0x0100, 35, 20000, VMC_SNIFFER_MAX_AGE_MS));
+    EXPECT_TRUE(sniffer.observed(0x0110, 1, 20000, VMC_SNIFFER_MAX_AGE_MS));
+    EXPECT_FALSE(sniffer.observed(0x0200, 51, 20000, VMC_SNIFFER_MAX_AGE_MS));
+    EXPECT_FALSE(sniffer.observed(0x0100, 35, 31000, VMC_SNIFFER_MAX_AGE_MS));
+}
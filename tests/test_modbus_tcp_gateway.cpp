@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_tcp_gateway.h"
+
+// ============================================================================
+// HELPER
+// ============================================================================
+
+static std::vector<uint8_t> registers(uint16_t count, uint16_t first)
+{
+    std::vector<uint8_t> data;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        data.push_back((first + i) >> 8);
+        data.push_back((first + i) & 0xFF);
+    }
+    return data;
+}
+
+// Frame MBAP completo: transaction 0x1234, unit 1
+static std::vector<uint8_t> frame(const std::vector<uint8_t> &pdu)
+{
+    std::vector<uint8_t> request = {0x12, 0x34, 0x00, 0x00, (uint8_t)((pdu.size() + 1) >> 8),
+                                    (uint8_t)((pdu.size() + 1) & 0xFF), 0x01};
+    request.insert(request.end(), pdu.begin(), pdu.end());
+    return request;
+}
+
+static std::vector<uint8_t> read_request(uint8_t function, uint16_t start, uint16_t count)
+{
+    return frame({function, (uint8_t)(start >> 8), (uint8_t)(start & 0xFF), (uint8_t)(count >> 8), (uint8_t)(count & 0xFF)});
+}
+
+class ModbusTcpGatewayTest : public ::testing::Test
+{
+protected:
+    ModbusRegisterCache cache;
+    std::vector<std::pair<uint16_t, std::vector<uint16_t>>> writes;
+    std::vector<ModbusTcpGateway::WriteDone> pending;
+    std::vector<std::vector<uint8_t>> deferred;
+    ModbusTcpGateway gateway{&cache, [this](uint16_t address, const std::vector<uint16_t> &values,
+                                            ModbusTcpGateway::WriteDone done)
+                             {
+                                 writes.push_back({address, values});
+                                 pending.push_back(done);
+                             }};
+
+    std::vector<uint8_t> transact(const std::vector<uint8_t> &request, uint32_t now_ms = 0)
+    {
+        std::vector<uint8_t> response;
+        EXPECT_EQ(gateway.handle(request, response, now_ms,
+                                 [this](const std::vector<uint8_t> &frame)
+                                 { deferred.push_back(frame); }),
+                  request.size());
+        return response;
+    }
+
+    // Completa la scrittura inoltrata più vecchia
+    void complete(uint8_t exception_code)
+    {
+        ASSERT_FALSE(pending.empty());
+        ModbusTcpGateway::WriteDone done = pending.front();
+        pending.erase(pending.begin());
+        done(exception_code);
+    }
+};
+
+// ============================================================================
+// TEST: letture dalla cache
+// ============================================================================
+
+TEST_F(ModbusTcpGatewayTest, ReadsFromCachedImage)
+{
+    cache.update(0x0100, registers(35, 0x0100), 1000);
+
+    std::vector<uint8_t> response = transact(read_request(0x03, 0x0110, 3));
+
+    std::vector<uint8_t> expected = {0x12, 0x34, 0x00, 0x00, 0x00, 0x09, 0x01, 0x03, 0x06,
+                                     0x01, 0x10, 0x01, 0x11, 0x01, 0x12};
+    EXPECT_EQ(response, expected);
+    EXPECT_EQ(gateway.requests(), 1u);
+}
+
+TEST_F(ModbusTcpGatewayTest, NeverReadRangeReturnsTargetNoResponse)
+{
+    std::vector<uint8_t> response = transact(read_request(0x03, 0x0200, 10));
+
+    ASSERT_EQ(response.size(), 9u);
+    EXPECT_EQ(response[7], 0x83);
+    EXPECT_EQ(response[8], MODBUS_EXCEPTION_TARGET_NO_RESPONSE);
+}
+
+TEST_F(ModbusTcpGatewayTest, OutOfRangeReadsAreIllegalAddress)
+{
+    cache.update(0x0000, registers(14, 0), 0);
+    cache.update(0x0100, registers(35, 0), 0);
+
+    // Oltre la fine del Block 0 e a cavallo tra due blocchi
+    EXPECT_EQ(transact(read_request(0x03, 0x000D, 2))[8], MODBUS_EXCEPTION_ILLEGAL_ADDRESS);
+    EXPECT_EQ(transact(read_request(0x03, 0x00FF, 2))[8], MODBUS_EXCEPTION_ILLEGAL_ADDRESS);
+    EXPECT_EQ(transact(read_request(0x03, 0x0900, 1))[8], MODBUS_EXCEPTION_ILLEGAL_ADDRESS);
+    EXPECT_EQ(transact(read_request(0x03, 0x0000, 0))[8], MODBUS_EXCEPTION_ILLEGAL_VALUE);
+}
+
+TEST_F(ModbusTcpGatewayTest, SingleRegisterUpdatesNeedFullRangeOnce)
+{
+    // Block 8 viene aggiornato registro per registro
+    cache.update_register(0x0800, 0x0A1E, 0);
+    EXPECT_EQ(transact(read_request(0x03, 0x0800, 1))[8], MODBUS_EXCEPTION_TARGET_NO_RESPONSE);
+
+    cache.update(0x0800, registers(2, 0x0A1E), 0);
+    cache.update_register(0x0801, 3, 0);
+
+    std::vector<uint8_t> response = transact(read_request(0x03, 0x0800, 2));
+    ASSERT_EQ(response.size(), 13u);
+    EXPECT_EQ(response[11], 0x00);
+    EXPECT_EQ(response[12], 0x03);
+}
+
+TEST_F(ModbusTcpGatewayTest, ReportsAgeOfEachRange)
+{
+    cache.update(0x0000, registers(14, 0), 1000);
+    cache.update(0x0300, registers(17, 0), 50000);
+
+    std::vector<uint8_t> response = transact(read_request(0x04, VMC_TCP_AGE_ADDRESS, 4), 61000);
+
+    std::vector<uint8_t> expected = {0x04, 0x08, 0x00, 60, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 11};
+    EXPECT_EQ(std::vector<uint8_t>(response.begin() + 7, response.end()), expected);
+
+    // Solo 9 intervalli
+    EXPECT_EQ(transact(read_request(0x04, VMC_TCP_AGE_ADDRESS + 8, 2))[8], MODBUS_EXCEPTION_ILLEGAL_ADDRESS);
+}
+
+// ============================================================================
+// TEST: scritture inoltrate
+// ============================================================================
+
+TEST_F(ModbusTcpGatewayTest, ForwardsSingleWriteAndEchoesRequest)
+{
+    std::vector<uint8_t> request = frame({0x06, 0x03, 0x07, 0x00, 0x04});
+
+    // Nessuna risposta finché la scrittura RTU non è confermata
+    EXPECT_TRUE(transact(request).empty());
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0].first, 0x0307);
+    EXPECT_EQ(writes[0].second, std::vector<uint16_t>{4});
+    EXPECT_TRUE(deferred.empty());
+
+    complete(0);
+
+    ASSERT_EQ(deferred.size(), 1u);
+    EXPECT_EQ(deferred[0], request);
+}
+
+TEST_F(ModbusTcpGatewayTest, ForwardsMultipleWrite)
+{
+    EXPECT_TRUE(transact(frame({0x10, 0x04, 0x00, 0x00, 0x02, 0x04, 0x06, 0x1E, 0x16, 0x00})).empty());
+    complete(0);
+
+    std::vector<uint8_t> expected = {0x12, 0x34, 0x00, 0x00, 0x00, 0x06, 0x01, 0x10, 0x04, 0x00, 0x00, 0x02};
+    ASSERT_EQ(deferred.size(), 1u);
+    EXPECT_EQ(deferred[0], expected);
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0].first, 0x0400);
+    EXPECT_EQ(writes[0].second, (std::vector<uint16_t>{0x061E, 0x1600}));
+    EXPECT_EQ(gateway.forwarded_writes(), 1u);
+}
+
+TEST_F(ModbusTcpGatewayTest, FailedWriteReturnsException)
+{
+    transact(frame({0x06, 0x03, 0x07, 0x00, 0x04}));
+    transact(frame({0x10, 0x04, 0x00, 0x00, 0x01, 0x02, 0x06, 0x1E}));
+
+    // Read-back diverso e nessuna risposta dalla VMC
+    complete(MODBUS_EXCEPTION_DEVICE_FAILURE);
+    complete(MODBUS_EXCEPTION_TARGET_NO_RESPONSE);
+
+    ASSERT_EQ(deferred.size(), 2u);
+    std::vector<uint8_t> expected = {0x12, 0x34, 0x00, 0x00, 0x00, 0x03, 0x01, 0x86, MODBUS_EXCEPTION_DEVICE_FAILURE};
+    EXPECT_EQ(deferred[0], expected);
+    EXPECT_EQ(deferred[1][7], 0x90);
+    EXPECT_EQ(deferred[1][8], MODBUS_EXCEPTION_TARGET_NO_RESPONSE);
+    EXPECT_EQ(gateway.failed_writes(), 2u);
+}
+
+TEST_F(ModbusTcpGatewayTest, WriteWithoutDeferredSenderIsRejected)
+{
+    std::vector<uint8_t> response;
+    std::vector<uint8_t> request = frame({0x06, 0x03, 0x07, 0x00, 0x04});
+
+    EXPECT_EQ(gateway.handle(request, response, 0), request.size());
+
+    ASSERT_EQ(response.size(), 9u);
+    EXPECT_EQ(response[8], MODBUS_EXCEPTION_TARGET_NO_RESPONSE);
+    EXPECT_TRUE(writes.empty());
+}
+
+TEST_F(ModbusTcpGatewayTest, RejectsWritesToReadOnlyBlocks)
+{
+    EXPECT_EQ(transact(frame({0x06, 0x01, 0x00, 0x00, 0x01}))[7], 0x86);
+    EXPECT_EQ(transact(frame({0x10, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x01}))[8], MODBUS_EXCEPTION_ILLEGAL_ADDRESS);
+    // Byte count incoerente
+    EXPECT_EQ(transact(frame({0x10, 0x03, 0x00, 0x00, 0x02, 0x02, 0x00, 0x01}))[8], MODBUS_EXCEPTION_ILLEGAL_VALUE);
+    EXPECT_TRUE(writes.empty());
+}
+
+TEST_F(ModbusTcpGatewayTest, RejectsWritesToNodeOwnedRegisters)
+{
+    // Flag della velocità del bus: FC06 e FC16 che li comprende
+    EXPECT_EQ(transact(frame({0x06, 0x02, 0x00, 0x00, 0x10}))[8], MODBUS_EXCEPTION_ILLEGAL_ADDRESS);
+    EXPECT_EQ(transact(frame({0x10, 0x02, 0x00, 0x00, 0x02, 0x04, 0x00, 0x10, 0x00, 0x01}))[8],
+              MODBUS_EXCEPTION_ILLEGAL_ADDRESS);
+    // Orologio della VMC (Block 8)
+    EXPECT_EQ(transact(frame({0x06, 0x08, 0x01, 0x00, 0x01}))[8], MODBUS_EXCEPTION_ILLEGAL_ADDRESS);
+    EXPECT_TRUE(writes.empty());
+    EXPECT_TRUE(deferred.empty());
+
+    // Il resto del Block 2 resta scrivibile
+    transact(frame({0x06, 0x02, 0x01, 0x00, 0x05}));
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0].first, 0x0201);
+}
+
+TEST_F(ModbusTcpGatewayTest, UnsupportedFunctionIsIllegalFunction)
+{
+    std::vector<uint8_t> response = transact(frame({0x01, 0x00, 0x00, 0x00, 0x01}));
+
+    EXPECT_EQ(response[7], 0x81);
+    EXPECT_EQ(response[8], MODBUS_EXCEPTION_ILLEGAL_FUNCTION);
+}
+
+// ============================================================================
+// TEST: framing TCP
+// ============================================================================
+
+TEST_F(ModbusTcpGatewayTest, WaitsForCompleteFrame)
+{
+    cache.update(0x0300, registers(17, 0), 0);
+    std::vector<uint8_t> request = read_request(0x03, 0x0300, 1);
+    std::vector<uint8_t> partial(request.begin(), request.begin() + 9);
+    std::vector<uint8_t> response;
+
+    EXPECT_EQ(gateway.handle(partial, response, 0), 0u);
+    EXPECT_TRUE(response.empty());
+}
+
+TEST_F(ModbusTcpGatewayTest, HandlesPipelinedRequests)
+{
+    cache.update(0x0300, registers(17, 0x0300), 0);
+    std::vector<uint8_t> buffer = read_request(0x03, 0x0300, 1);
+    std::vector<uint8_t> second = read_request(0x03, 0x0301, 1);
+    buffer.insert(buffer.end(), second.begin(), second.end());
+    std::vector<uint8_t> response;
+
+    size_t consumed;
+    while ((consumed = gateway.handle(buffer, response, 0)) > 0)
+        buffer.erase(buffer.begin(), buffer.begin() + consumed);
+
+    EXPECT_TRUE(buffer.empty());
+    ASSERT_EQ(response.size(), 22u);
+    EXPECT_EQ(response[21], 0x01);
+}
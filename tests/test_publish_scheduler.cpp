@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <string>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/publish_scheduler.h"
+
+// ============================================================================
+// HELPER: entità simulate che registrano l'ordine di pubblicazione
+// ============================================================================
+
+static std::vector<std::string> published;
+
+template <typename T>
+struct MockEntity
+{
+    std::string name;
+    T state;
+    int publishes;
+
+    MockEntity(const std::string &entity_name = "") : name(entity_name), state(), publishes(0) {}
+
+    void publish_state(T value)
+    {
+        state = value;
+        publishes++;
+        published.push_back(name);
+    }
+};
+
+// Orologio simulato: ogni lettura avanza di step_us
+struct FakeClock
+{
+    uint32_t now = 0;
+    uint32_t step_us;
+    explicit FakeClock(uint32_t step) : step_us(step) {}
+    std::function<uint32_t()> fn()
+    {
+        return [this]() { uint32_t t = now; now += step_us; return t; };
+    }
+};
+
+class PublishSchedulerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override { published.clear(); }
+};
+
+// ============================================================================
+// TEST: ordine e fusione
+// ============================================================================
+
+TEST_F(PublishSchedulerTest, PublishesByPriorityThenFifo)
+{
+    PublishScheduler scheduler(1000000);
+    MockEntity<float> speed{"speed"}, temperature{"temperature"}, offset{"offset"};
+    MockEntity<bool> frost{"frost"};
+    MockEntity<std::string> season{"season"};
+
+    scheduler.publish(&offset, 1.5f, PUBLISH_PARAMETER);
+    scheduler.publish(&temperature, 21.5f, PUBLISH_MEASURE);
+    scheduler.publish(&season, std::string("Winter"), PUBLISH_MEASURE);
+    scheduler.publish(&frost, true, PUBLISH_ALARM);
+    scheduler.publish(&speed, 2.0f, PUBLISH_MEASURE);
+
+    EXPECT_TRUE(published.empty()); // Nulla pubblicato prima di drain()
+    FakeClock clock(1);
+    EXPECT_EQ(scheduler.drain(clock.fn()), 5u);
+
+    EXPECT_EQ(published, (std::vector<std::string>{"frost", "temperature", "season", "speed", "offset"}));
+    EXPECT_TRUE(frost.state);
+    EXPECT_EQ(season.state, "Winter");
+    EXPECT_EQ(scheduler.queued(), 0u);
+}
+
+TEST_F(PublishSchedulerTest, MergesUpdatesOfQueuedEntity)
+{
+    PublishScheduler scheduler(1000000);
+    MockEntity<float> t1{"t1"}, t2{"t2"};
+
+    scheduler.publish(&t1, 20.0f, PUBLISH_MEASURE);
+    scheduler.publish(&t2, 18.0f, PUBLISH_MEASURE);
+    scheduler.publish(&t1, 20.5f, PUBLISH_MEASURE); // Nuova risposta prima della pubblicazione
+
+    EXPECT_EQ(scheduler.queued(), 2u);
+    EXPECT_EQ(scheduler.merged(), 1u);
+    FakeClock clock(1);
+    scheduler.drain(clock.fn());
+
+    // Un solo publish con l'ultimo valore, nella posizione del primo accodamento
+    EXPECT_EQ(published, (std::vector<std::string>{"t1", "t2"}));
+    EXPECT_EQ(t1.publishes, 1);
+    EXPECT_FLOAT_EQ(t1.state, 20.5f);
+}
+
+TEST_F(PublishSchedulerTest, ReusesEntitySlotsAcrossRounds)
+{
+    PublishScheduler scheduler(1000000);
+    MockEntity<float> rpm{"rpm"};
+    MockEntity<bool> fans{"fans"};
+    MockEntity<std::string> mode{"mode"};
+    FakeClock clock(1);
+
+    for (int round = 0; round < 3; round++)
+    {
+        scheduler.publish(&rpm, (uint16_t)(1200 + round), PUBLISH_MEASURE); // Interi convertiti in float
+        scheduler.publish(&fans, round == 1, PUBLISH_ALARM);
+        scheduler.publish(&mode, round == 2 ? "Party" : "Auto", PUBLISH_MEASURE);
+        EXPECT_EQ(scheduler.drain(clock.fn()), 3u);
+    }
+
+    EXPECT_EQ(scheduler.entities(), 3u);
+    EXPECT_EQ(scheduler.max_queued(), 3u);
+    EXPECT_FLOAT_EQ(rpm.state, 1202.0f);
+    EXPECT_FALSE(fans.state);
+    EXPECT_EQ(mode.state, "Party");
+    EXPECT_EQ(rpm.publishes, 3);
+}
+
+// ============================================================================
+// TEST: budget per iterazione
+// ============================================================================
+
+TEST_F(PublishSchedulerTest, StopsWhenBudgetIsUsed)
+{
+    // 70 parametri del Block 2, 100 µs per publish, budget di 1 ms
+    PublishScheduler scheduler(1000);
+    std::vector<MockEntity<float>> parameters(70);
+    for (size_t i = 0; i < parameters.size(); i++)
+        scheduler.publish(&parameters[i], (float)i, PUBLISH_PARAMETER);
+
+    FakeClock clock(100);
+    size_t iterations = 0;
+    while (scheduler.queued() > 0)
+    {
+        EXPECT_LE(scheduler.drain(clock.fn()), 10u);
+        iterations++;
+    }
+    EXPECT_EQ(iterations, 7u);
+    EXPECT_EQ(scheduler.max_queued(), 70u);
+    EXPECT_FLOAT_EQ(parameters[69].state, 69.0f);
+}
+
+TEST_F(PublishSchedulerTest, AlarmsQueuedLaterOvertakeParameters)
+{
+    PublishScheduler scheduler(1000);
+    std::vector<MockEntity<float>> parameters(30);
+    for (size_t i = 0; i < parameters.size(); i++)
+        scheduler.publish(&parameters[i], (float)i, PUBLISH_PARAMETER);
+    FakeClock clock(100);
+    scheduler.drain(clock.fn());
+
+    // Arriva il Block 1 mentre i parametri sono ancora in coda
+    MockEntity<bool> fans{"fans"};
+    scheduler.publish(&fans, true, PUBLISH_ALARM);
+    published.clear();
+    scheduler.drain(clock.fn());
+
+    ASSERT_FALSE(published.empty());
+    EXPECT_EQ(published.front(), "fans");
+}
+
+TEST_F(PublishSchedulerTest, AlwaysPublishesAtLeastOneValue)
+{
+    PublishScheduler scheduler(0);
+    MockEntity<float> a{"a"}, b{"b"};
+    scheduler.publish(&a, 1.0f, PUBLISH_MEASURE);
+    scheduler.publish(&b, 2.0f, PUBLISH_MEASURE);
+
+    FakeClock clock(1000);
+    EXPECT_EQ(scheduler.drain(clock.fn()), 1u);
+    EXPECT_EQ(scheduler.drain(clock.fn()), 1u);
+    EXPECT_EQ(scheduler.drain(clock.fn()), 0u);
+}
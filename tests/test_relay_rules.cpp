@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/relay_rules.h"
+
+// ============================================================================
+// HELPER: immagini dei Block 1 e 2 e relè simulati
+// ============================================================================
+
+static void set_register(std::vector<uint8_t> &image, uint16_t offset_registers, uint16_t value)
+{
+    image[offset_registers * 2] = value >> 8;
+    image[offset_registers * 2 + 1] = value & 0xFF;
+}
+
+class RelayRulesTest : public ::testing::Test
+{
+protected:
+    RelayRuleEngine engine;
+    std::vector<std::pair<uint8_t, bool>> writes;
+    std::vector<uint8_t> block1 = std::vector<uint8_t>(70, 0);
+    std::vector<uint8_t> block2 = std::vector<uint8_t>(102, 0);
+
+    void SetUp() override
+    {
+        // Riscaldatore: T4 (0x0103) sotto la soglia 0x0232 con 1 °C di isteresi, VMC accesa
+        std::vector<RelayRule> rules = {
+            {1, {RuleCondition::below_register(0x0103, 0x0232, 10), RuleCondition::bits_any(0x0105, 1 << 8)}, 300000, 300000, false},
+            // Serranda: nessun allarme antigelo o ventilatori
+            {2, {RuleCondition::bits_none(0x0110, (1 << 6) | (1 << 10))}, 0, 0, false},
+        };
+        engine.set_rules(rules, [this](uint8_t relay, bool on) { writes.push_back(std::make_pair(relay, on)); });
+
+        set_register(block1, 0x03, (uint16_t)(int16_t)-20); // T4 -2.0 °C
+        set_register(block1, 0x05, 1 << 8);                 // VMC accesa
+        set_register(block2, 0x32, (uint16_t)(int16_t)-10); // Soglia -1.0 °C
+    }
+
+    void t4(int16_t tenths, uint32_t now_ms)
+    {
+        set_register(block1, 0x03, (uint16_t)tenths);
+        engine.on_registers(0x0100, block1, now_ms);
+    }
+};
+
+// ============================================================================
+// TEST: valutazione
+// ============================================================================
+
+TEST_F(RelayRulesTest, WaitsForAllInputRegisters)
+{
+    engine.on_registers(0x0100, block1, 0);
+
+    // Soglia del Block 2 non ancora letta: il riscaldatore non decide
+    EXPECT_EQ(engine.output(0), -1);
+    EXPECT_EQ(engine.output(1), 1);
+
+    engine.on_registers(0x0200, block2, 100);
+    EXPECT_EQ(engine.output(0), 1);
+    EXPECT_EQ(writes, (std::vector<std::pair<uint8_t, bool>>{{2, true}, {1, true}}));
+}
+
+TEST_F(RelayRulesTest, EvaluatesOnlyWhenInputsChange)
+{
+    engine.on_registers(0x0200, block2, 0);
+    engine.on_registers(0x0100, block1, 0);
+    uint32_t evaluations = engine.evaluations();
+
+    // Stesse immagini e registri non usati dalle regole: nessuna valutazione
+    engine.on_registers(0x0100, block1, 30000);
+    set_register(block1, 0x00, 215); // T1
+    engine.on_registers(0x0100, block1, 60000);
+    engine.on_registers(0x0300, std::vector<uint8_t>(34, 0xFF), 60000);
+    engine.tick(60000);
+    EXPECT_EQ(engine.evaluations(), evaluations);
+
+    // Cambia solo l'allarme: solo la serranda
+    set_register(block1, 0x10, 1 << 10);
+    engine.on_registers(0x0100, block1, 90000);
+    EXPECT_EQ(engine.evaluations(), evaluations + 1);
+    EXPECT_EQ(engine.output(1), 0);
+}
+
+TEST_F(RelayRulesTest, AppliesHysteresisOnTheWayBack)
+{
+    engine.on_registers(0x0200, block2, 0);
+    engine.on_registers(0x0100, block1, 0);
+    ASSERT_EQ(engine.output(0), 1);
+
+    // Acceso fino a soglia + isteresi (-1.0 + 1.0 °C)
+    t4(-5, 400000);
+    EXPECT_EQ(engine.output(0), 1);
+    t4(0, 800000);
+    EXPECT_EQ(engine.output(0), 0);
+
+    // Spento fino a sotto la soglia
+    t4(-5, 1200000);
+    EXPECT_EQ(engine.output(0), 0);
+    t4(-11, 1600000);
+    EXPECT_EQ(engine.output(0), 1);
+}
+
+// ============================================================================
+// TEST: tempi minimi e stato sicuro
+// ============================================================================
+
+TEST_F(RelayRulesTest, DefersSwitchingUntilMinimumOnTime)
+{
+    engine.on_registers(0x0200, block2, 0);
+    engine.on_registers(0x0100, block1, 0);
+    writes.clear();
+
+    t4(50, 60000); // +5.0 °C dopo un minuto: deve restare acceso 5 minuti
+    EXPECT_EQ(engine.output(0), 1);
+    EXPECT_TRUE(engine.deferred(0));
+
+    engine.tick(299999);
+    EXPECT_TRUE(writes.empty());
+    engine.tick(300000);
+    EXPECT_EQ(engine.output(0), 0);
+    EXPECT_FALSE(engine.deferred(0));
+    EXPECT_EQ(writes, (std::vector<std::pair<uint8_t, bool>>{{1, false}}));
+}
+
+TEST_F(RelayRulesTest, DeferredSwitchIsCancelledWhenConditionReturns)
+{
+    engine.on_registers(0x0200, block2, 0);
+    engine.on_registers(0x0100, block1, 0);
+    writes.clear();
+
+    t4(50, 60000);
+    ASSERT_TRUE(engine.deferred(0));
+    t4(-20, 120000);
+    EXPECT_FALSE(engine.deferred(0));
+
+    engine.tick(300000);
+    EXPECT_TRUE(writes.empty());
+    EXPECT_EQ(engine.output(0), 1);
+}
+
+TEST_F(RelayRulesTest, LinkLostForcesSafeStateImmediately)
+{
+    engine.on_registers(0x0200, block2, 0);
+    engine.on_registers(0x0100, block1, 0);
+    writes.clear();
+
+    engine.on_link_lost(1000); // Prima dei 5 minuti minimi
+    EXPECT_EQ(engine.output(0), 0);
+    EXPECT_EQ(engine.output(1), 0);
+    EXPECT_EQ(writes.size(), 2u);
+
+    // Al ritorno del link servono di nuovo entrambi i blocchi, poi valgono i tempi minimi
+    engine.on_registers(0x0100, block1, 2000);
+    EXPECT_EQ(engine.output(0), 0);
+    engine.on_registers(0x0200, block2, 3000);
+    EXPECT_TRUE(engine.deferred(0));
+    engine.tick(301000);
+    EXPECT_EQ(engine.output(0), 1);
+}
+
+TEST(RelayRuleConditionTest, FieldEqualsAndAboveWithConstantThreshold)
+{
+    RelayRuleEngine engine;
+    std::vector<RelayRule> rules = {
+        // Modo Manual (0x0105 bit 9-10 = 3) e T1 sopra 25.0 °C con isteresi 0.5 °C
+        {3, {RuleCondition::field_equals(0x0105, 0x0600, 0x0600), RuleCondition::above(0x0100, 250, 5)}, 0, 0, false},
+    };
+    engine.set_rules(rules, RelayRuleEngine::RelayWriter());
+    std::vector<uint8_t> block1(70, 0);
+
+    set_register(block1, 0x05, 0x0600);
+    set_register(block1, 0x00, 255);
+    engine.on_registers(0x0100, block1, 0);
+    EXPECT_EQ(engine.output(0), 1);
+
+    set_register(block1, 0x00, 248); // Sopra 25.0 - 0.5
+    engine.on_registers(0x0100, block1, 1);
+    EXPECT_EQ(engine.output(0), 1);
+
+    set_register(block1, 0x05, 0x0200); // Modo Auto
+    engine.on_registers(0x0100, block1, 2);
+    EXPECT_EQ(engine.output(0), 0);
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// Mock del ModbusController e ModbusCommandItem
+namespace modbus_controller
+{
+    class ModbusCommandItem
+    {
+    public:
+        uint16_t address = 0;
+        uint16_t count = 0;
+        std::vector<uint16_t> values;
+
+        static std::shared_ptr<ModbusCommandItem> create_write_multiple_command(
+            class ModbusController *controller, uint16_t address, uint16_t count, const std::vector<uint16_t> &values)
+        {
+            auto cmd = std::make_shared<ModbusCommandItem>();
+            cmd->address = address;
+            cmd->count = count;
+            cmd->values = values;
+            return cmd;
+        }
+    };
+
+    class ModbusController
+    {
+    public:
+        std::vector<std::shared_ptr<ModbusCommandItem>> commands;
+
+        void queue_command(std::shared_ptr<ModbusCommandItem> command) { commands.push_back(command); }
+    };
+}
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_helpers.h"
+#include "../config/Blk2_MachineParameters.h"
+#include "../config/seasonal_controller.h"
+
+// ============================================================================
+// HELPER: campioni di T1 e immagine del Block 2
+// ============================================================================
+
+static const uint32_t BUCKET_MS = 600000;
+
+// Controller con bucket da 10 minuti, anello di 6 medie, decisione dopo 3
+static SeasonalController make_controller()
+{
+    return SeasonalController(250, 30, BUCKET_MS, 6, 3);
+}
+
+// Un bucket intero a temperatura costante (un campione ogni 30 s); ritorna
+// true se la chiusura del bucket ha cambiato stagione
+static bool feed_bucket(SeasonalController &controller, int16_t tenths, uint32_t &now_ms)
+{
+    bool changed = false;
+    for (uint32_t t = 0; t <= BUCKET_MS; t += 30000)
+        changed = controller.on_t1(tenths, now_ms + t) || changed;
+    now_ms += BUCKET_MS + 30000;
+    return changed;
+}
+
+static std::vector<uint8_t> make_image(int16_t free_cooling, int16_t free_heating)
+{
+    std::vector<uint8_t> image(BLK2_IMAGE_SIZE, 0);
+    image[(0x021B - BLK2_ADDRESS) * 2] = (uint16_t)free_cooling >> 8;
+    image[(0x021B - BLK2_ADDRESS) * 2 + 1] = free_cooling & 0xFF;
+    image[(0x021C - BLK2_ADDRESS) * 2] = (uint16_t)free_heating >> 8;
+    image[(0x021C - BLK2_ADDRESS) * 2 + 1] = free_heating & 0xFF;
+    return image;
+}
+
+// ============================================================================
+// TEST: MEDIA MOBILE E STAGIONE
+// ============================================================================
+
+TEST(SeasonalControllerTest, NoDecisionBeforeMinimumBuckets)
+{
+    SeasonalController controller = make_controller();
+    uint32_t now = 1000;
+    EXPECT_FALSE(feed_bucket(controller, 300, now));
+    EXPECT_FALSE(feed_bucket(controller, 300, now));
+    EXPECT_EQ(Season::UNKNOWN, controller.season());
+    EXPECT_FALSE(controller.has_average());
+    EXPECT_FALSE(controller.write_pending());
+
+    // Terza media: prima decisione, conta come cambio
+    EXPECT_TRUE(feed_bucket(controller, 300, now));
+    EXPECT_EQ(Season::SUMMER, controller.season());
+    EXPECT_EQ(300, controller.average());
+    EXPECT_TRUE(controller.write_pending());
+    EXPECT_EQ(1u, controller.transitions());
+}
+
+TEST(SeasonalControllerTest, MovingAverageDropsOldestBuckets)
+{
+    SeasonalController controller = make_controller();
+    uint32_t now = 1000;
+    for (int i = 0; i < 6; i++)
+        feed_bucket(controller, 100, now);
+    EXPECT_EQ(100, controller.average());
+
+    // Sei medie nuove sostituiscono tutte le vecchie
+    for (int i = 0; i < 3; i++)
+        feed_bucket(controller, 200, now);
+    EXPECT_EQ(150, controller.average());
+    for (int i = 0; i < 3; i++)
+        feed_bucket(controller, 200, now);
+    EXPECT_EQ(200, controller.average());
+}
+
+TEST(SeasonalControllerTest, BucketMeanIsRounded)
+{
+    SeasonalController controller(250, 30, BUCKET_MS, 6, 1);
+    controller.on_t1(-11, 0);
+    controller.on_t1(-12, BUCKET_MS);
+    EXPECT_EQ(-12, controller.average()); // -11.5 arrotondato lontano da zero
+
+    controller = SeasonalController(250, 30, BUCKET_MS, 1, 1);
+    controller.on_t1(101, 0);
+    controller.on_t1(102, BUCKET_MS);
+    EXPECT_EQ(102, controller.average());
+}
+
+TEST(SeasonalControllerTest, HysteresisPreventsFlapping)
+{
+    SeasonalController controller = make_controller();
+    uint32_t now = 1000;
+    for (int i = 0; i < 3; i++)
+        feed_bucket(controller, 200, now);
+    EXPECT_EQ(Season::WINTER, controller.season());
+
+    // Estate appena la media supera 25.0 °C
+    int changes = 0;
+    for (int i = 0; i < 6; i++)
+        changes += feed_bucket(controller, 280, now);
+    EXPECT_EQ(Season::SUMMER, controller.season());
+    EXPECT_EQ(1, changes);
+
+    // Media a 23.0 °C: dentro la banda, resta estate
+    for (int i = 0; i < 6; i++)
+        EXPECT_FALSE(feed_bucket(controller, 230, now));
+    EXPECT_EQ(Season::SUMMER, controller.season());
+
+    // Sotto 22.0 °C si torna all'inverno
+    changes = 0;
+    for (int i = 0; i < 6; i++)
+        changes += feed_bucket(controller, 210, now);
+    EXPECT_EQ(Season::WINTER, controller.season());
+    EXPECT_EQ(1, changes);
+    EXPECT_EQ(3u, controller.transitions());
+}
+
+// ============================================================================
+// TEST: SCRITTURE DELLE SOGLIE
+// ============================================================================
+
+TEST(SeasonalControllerTest, WritesOnlyDifferingRegisters)
+{
+    SeasonalController controller = make_controller();
+    uint32_t now = 1000;
+    for (int i = 0; i < 3; i++)
+        feed_bucket(controller, 300, now);
+    ASSERT_EQ(Season::SUMMER, controller.season());
+
+    // Free heating già a 18.0 °C: si scrive solo 0x021B
+    std::vector<WriteRange> plan;
+    ASSERT_TRUE(controller.take_write_plan(make_image(260, 180), plan));
+    ASSERT_EQ(1u, plan.size());
+    EXPECT_EQ(0x021B, plan[0].address);
+    ASSERT_EQ(1u, plan[0].values.size());
+    EXPECT_EQ(220, plan[0].values[0]);
+    EXPECT_FALSE(controller.write_pending());
+
+    // Nessuna nuova scrittura senza cambio di stagione
+    EXPECT_FALSE(controller.take_write_plan(make_image(260, 150), plan));
+    EXPECT_TRUE(plan.empty());
+
+    // Ritorno all'inverno: entrambe le soglie diverse, un solo frame
+    for (int i = 0; i < 6; i++)
+        feed_bucket(controller, 100, now);
+    ASSERT_EQ(Season::WINTER, controller.season());
+    ASSERT_TRUE(controller.take_write_plan(make_image(220, 180), plan));
+    ASSERT_EQ(1u, plan.size());
+    EXPECT_EQ(0x021B, plan[0].address);
+    ASSERT_EQ(2u, plan[0].values.size());
+    EXPECT_EQ(260, plan[0].values[0]);
+    EXPECT_EQ(150, plan[0].values[1]);
+}
+
+TEST(SeasonalControllerTest, UnchangedThresholdsNeedNoWrite)
+{
+    SeasonalController controller = make_controller();
+    uint32_t now = 1000;
+    for (int i = 0; i < 3; i++)
+        feed_bucket(controller, 150, now);
+    ASSERT_EQ(Season::WINTER, controller.season());
+
+    std::vector<WriteRange> plan;
+    EXPECT_TRUE(controller.take_write_plan(make_image(260, 150), plan));
+    EXPECT_TRUE(plan.empty());
+    EXPECT_FALSE(controller.write_pending());
+}
+
+TEST(SeasonalControllerTest, WriteWaitsForBlock2Image)
+{
+    SeasonalController controller = make_controller();
+    uint32_t now = 1000;
+    for (int i = 0; i < 3; i++)
+        feed_bucket(controller, 300, now);
+
+    std::vector<WriteRange> plan;
+    EXPECT_FALSE(controller.take_write_plan(std::vector<uint8_t>(), plan));
+    EXPECT_TRUE(controller.write_pending());
+
+    EXPECT_TRUE(controller.take_write_plan(make_image(0, 0), plan));
+    ASSERT_EQ(1u, plan.size());
+    EXPECT_EQ(220, plan[0].values[0]);
+    EXPECT_EQ(180, plan[0].values[1]);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/vmc_capabilities.h"
+
+// Bit del registro 0x11F
+static const uint16_t OPT_CO2 = 1 << 12;
+static const uint16_t OPT_DP = 1 << 13;
+static const uint16_t OPT_RH = 1 << 14;
+static const uint16_t OPT_OTHER = (1 << 8) | (1 << 10) | (1 << 15); // IAQ, HE, reverse mounting
+
+// ============================================================================
+// TEST: modello (Block 0)
+// ============================================================================
+
+TEST(VmcModelTest, KnownModelNames)
+{
+    EXPECT_EQ(vmc_model_name(0x5200), "ESP170V");
+    EXPECT_EQ(vmc_model_name(0x5208), "ESP600");
+    EXPECT_EQ(vmc_model_name(0x5300), "ENYP1");
+    EXPECT_EQ(vmc_model_name(0x5303), "ENYP4");
+}
+
+TEST(VmcModelTest, UnknownModelIsEmpty)
+{
+    EXPECT_EQ(vmc_model_name(0x0000), "");
+    EXPECT_EQ(vmc_model_name(0x5209), "");
+
+    VmcCapabilities caps;
+    caps.on_model(0x1234);
+    EXPECT_FALSE(caps.model_known());
+    caps.on_model(0x5302);
+    EXPECT_TRUE(caps.model_known());
+    EXPECT_EQ(caps.model_code(), 0x5302);
+}
+
+// ============================================================================
+// TEST: sonde opzionali (0x11F)
+// ============================================================================
+
+TEST(VmcCapabilitiesTest, EverythingAvailableBeforeFirstRead)
+{
+    VmcCapabilities caps;
+
+    EXPECT_FALSE(caps.resolved());
+    EXPECT_TRUE(caps.has(CAP_CO2_SENSOR));
+    EXPECT_TRUE(caps.has(CAP_DIFF_PRESSURE_SENSOR));
+    EXPECT_TRUE(caps.has(CAP_RH_SENSOR));
+}
+
+TEST(VmcCapabilitiesTest, DecodesPresentBits)
+{
+    EXPECT_EQ(capabilities_from_options(0), 0);
+    EXPECT_EQ(capabilities_from_options(OPT_OTHER), 0);
+    EXPECT_EQ(capabilities_from_options(OPT_CO2), CAP_CO2_SENSOR);
+    EXPECT_EQ(capabilities_from_options(OPT_DP | OPT_OTHER), CAP_DIFF_PRESSURE_SENSOR);
+    EXPECT_EQ(capabilities_from_options(OPT_CO2 | OPT_DP | OPT_RH), CAP_ALL_SENSORS);
+}
+
+TEST(VmcCapabilitiesTest, AbsentSensorsAreReportedOnceAndSkipped)
+{
+    VmcCapabilities caps;
+
+    // Macchina con sola sonda RH: CO2 e pressione da marcare non disponibili
+    uint8_t removed = caps.on_options(OPT_RH | OPT_OTHER);
+    EXPECT_EQ(removed, CAP_CO2_SENSOR | CAP_DIFF_PRESSURE_SENSOR);
+    EXPECT_TRUE(caps.resolved());
+    EXPECT_FALSE(caps.has(CAP_CO2_SENSOR));
+    EXPECT_FALSE(caps.has(CAP_DIFF_PRESSURE_SENSOR));
+    EXPECT_TRUE(caps.has(CAP_RH_SENSOR));
+
+    // Giri successivi identici: niente da ripubblicare
+    EXPECT_EQ(caps.on_options(OPT_RH | OPT_OTHER), 0);
+    EXPECT_EQ(caps.capabilities(), CAP_RH_SENSOR);
+}
+
+TEST(VmcCapabilitiesTest, FullyEquippedMachineRemovesNothing)
+{
+    VmcCapabilities caps;
+
+    EXPECT_EQ(caps.on_options(OPT_CO2 | OPT_DP | OPT_RH), 0);
+    EXPECT_EQ(caps.capabilities(), CAP_ALL_SENSORS);
+}
+
+TEST(VmcCapabilitiesTest, SensorAddedAndRemovedAtRuntime)
+{
+    VmcCapabilities caps;
+    caps.on_options(0);
+    EXPECT_FALSE(caps.has(CAP_CO2_SENSOR));
+
+    // Sonda CO2 installata e configurata sulla VMC
+    EXPECT_EQ(caps.on_options(OPT_CO2), 0);
+    EXPECT_TRUE(caps.has(CAP_CO2_SENSOR));
+
+    // Sonda rimossa: va di nuovo marcata non disponibile
+    EXPECT_EQ(caps.on_options(0), CAP_CO2_SENSOR);
+    EXPECT_FALSE(caps.has(CAP_CO2_SENSOR));
+}
+
+TEST(VmcCapabilitiesTest, HasRequiresAllRequestedBits)
+{
+    VmcCapabilities caps;
+    caps.on_options(OPT_CO2);
+
+    EXPECT_TRUE(caps.has(CAP_CO2_SENSOR));
+    EXPECT_FALSE(caps.has(CAP_CO2_SENSOR | CAP_RH_SENSOR));
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// Stub per delay
+void delay(int ms) {}
+
+// Mock minimo del ModbusController (richiesto da Blk4_UserTimerProgram.h)
+namespace modbus_controller
+{
+    class ModbusCommandItem
+    {
+    public:
+        static std::shared_ptr<ModbusCommandItem> create_write_multiple_command(
+            class ModbusController *controller, uint16_t address, uint16_t count, const std::vector<uint16_t> &values)
+        {
+            return std::make_shared<ModbusCommandItem>();
+        }
+    };
+
+    class ModbusController
+    {
+    public:
+        void queue_command(std::shared_ptr<ModbusCommandItem> command) {}
+    };
+}
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_helpers.h"
+#include "../config/vmc_state.h"
+#include "../config/Blk4_UserTimerProgram.h"
+#include "../config/vmc_http_state.h"
+
+// ============================================================================
+// HELPER
+// ============================================================================
+
+static std::vector<uint8_t> block_image(uint8_t block, uint16_t value)
+{
+    std::vector<uint8_t> data;
+    for (uint16_t i = 0; i < VMC_STATE_BLOCK_REGISTERS[block]; i++)
+    {
+        data.push_back(value >> 8);
+        data.push_back(value & 0xFF);
+    }
+    return data;
+}
+
+static void full_round(VmcState &state, uint16_t value, uint32_t now_ms)
+{
+    for (uint8_t b = 0; b < VMC_STATE_BLOCK_COUNT; b++)
+        state.store_block(b, block_image(b, value), now_ms);
+}
+
+// Programma valido: tutti i giorni 00:00 a velocità 1, resto 23:59
+static std::vector<uint8_t> simple_program()
+{
+    std::vector<uint8_t> data(238, 0);
+    for (int reg = 0; reg < 56; reg++)
+    {
+        data[reg * 2] = 23;
+        data[reg * 2 + 1] = 59;
+    }
+    for (int reg = 56; reg < 119; reg++)
+        data[reg * 2 + 1] = 1;
+    return data;
+}
+
+class VmcHttpStateTest : public ::testing::Test
+{
+protected:
+    VmcState state;
+    VmcStateDocument document;
+    std::vector<std::vector<uint8_t>> programs{std::vector<std::vector<uint8_t>>(4)};
+};
+
+// ============================================================================
+// TEST: cache e ETag
+// ============================================================================
+
+TEST_F(VmcHttpStateTest, NotReadyBeforeFirstRound)
+{
+    EXPECT_FALSE(document.refresh(state.current(), programs));
+    EXPECT_FALSE(document.ready());
+    EXPECT_FALSE(document.not_modified("*"));
+}
+
+TEST_F(VmcHttpStateTest, RendersOncePerRound)
+{
+    full_round(state, 1, 0);
+
+    EXPECT_TRUE(document.refresh(state.current(), programs));
+    EXPECT_FALSE(document.refresh(state.current(), programs));
+    EXPECT_FALSE(document.refresh(state.current(), programs));
+    EXPECT_EQ(document.renders(), 1u);
+
+    full_round(state, 2, 30000);
+    EXPECT_TRUE(document.refresh(state.current(), programs));
+    EXPECT_EQ(document.renders(), 2u);
+}
+
+TEST_F(VmcHttpStateTest, EtagChangesWithRoundAndPrograms)
+{
+    full_round(state, 1, 0);
+    document.refresh(state.current(), programs);
+    std::string first = document.etag();
+
+    programs[1] = simple_program();
+    EXPECT_TRUE(document.refresh(state.current(), programs));
+    std::string second = document.etag();
+    EXPECT_NE(first, second);
+
+    full_round(state, 1, 30000);
+    document.refresh(state.current(), programs);
+    EXPECT_NE(document.etag(), second);
+}
+
+TEST_F(VmcHttpStateTest, MatchesIfNoneMatch)
+{
+    full_round(state, 1, 0);
+    document.refresh(state.current(), programs);
+    std::string etag = document.etag();
+
+    EXPECT_EQ(etag.front(), '"');
+    EXPECT_TRUE(document.not_modified(etag));
+    EXPECT_TRUE(document.not_modified("\"old\", " + etag));
+    EXPECT_TRUE(document.not_modified("*"));
+    EXPECT_FALSE(document.not_modified(""));
+    EXPECT_FALSE(document.not_modified("\"1-00000000\""));
+
+    full_round(state, 2, 30000);
+    document.refresh(state.current(), programs);
+    EXPECT_FALSE(document.not_modified(etag));
+}
+
+TEST_F(VmcHttpStateTest, SnapshotSkipsBodyWhenNotModified)
+{
+    std::string etag;
+    std::string body;
+    bool not_modified = false;
+    EXPECT_FALSE(document.snapshot("", etag, body, not_modified));
+
+    full_round(state, 1, 0);
+    document.refresh(state.current(), programs);
+
+    ASSERT_TRUE(document.snapshot("", etag, body, not_modified));
+    EXPECT_FALSE(not_modified);
+    EXPECT_EQ(etag, document.etag());
+    EXPECT_EQ(body, document.body());
+
+    body.clear();
+    std::string cached = etag;
+    ASSERT_TRUE(document.snapshot(cached, etag, body, not_modified));
+    EXPECT_TRUE(not_modified);
+    EXPECT_TRUE(body.empty());
+
+    // Il rendering successivo non tocca la copia già consegnata
+    std::string served = document.body();
+    full_round(state, 2, 30000);
+    document.refresh(state.current(), programs);
+    ASSERT_TRUE(document.snapshot("", etag, body, not_modified));
+    EXPECT_EQ(body, document.body());
+    EXPECT_NE(body, served);
+}
+
+// ============================================================================
+// TEST: contenuto del documento
+// ============================================================================
+
+TEST_F(VmcHttpStateTest, ContainsDecodedValuesAndRawBlocks)
+{
+    state.store_block(0, block_image(0, 0), 0);
+    std::vector<uint8_t> blk1 = block_image(1, 0);
+    blk1[0] = 0xFF; // T1 = -2.5 °C
+    blk1[1] = 0xE7;
+    blk1[38] = 0x02; // CO2 = 650 ppm
+    blk1[39] = 0x8A;
+    state.store_block(1, blk1, 0);
+    state.store_block(2, block_image(2, 0), 0);
+    std::vector<uint8_t> blk3 = block_image(3, 0);
+    blk3[15] = 4; // 0x0307 = Party
+    state.store_block(3, blk3, 0);
+
+    document.refresh(state.current(), programs);
+    const std::string &body = document.body();
+
+    EXPECT_EQ(body.find("{\"sequence\":1,"), 0u);
+    EXPECT_NE(body.find("\"t1\":-2.5"), std::string::npos);
+    EXPECT_NE(body.find("\"co2\":650"), std::string::npos);
+    EXPECT_NE(body.find("\"mode\":4"), std::string::npos);
+    EXPECT_NE(body.find("\"0x0100\":[65511,"), std::string::npos);
+    EXPECT_NE(body.find("\"programs\":[null,null,null,null]"), std::string::npos);
+    EXPECT_EQ(body.back(), '}');
+}
+
+TEST_F(VmcHttpStateTest, MissingBlocksAreNull)
+{
+    state.store_block(1, block_image(1, 0), 0);
+    state.commit(0);
+
+    document.refresh(state.current(), programs);
+    const std::string &body = document.body();
+
+    EXPECT_NE(body.find("\"0x0000\":null"), std::string::npos);
+    EXPECT_NE(body.find("\"mode\":null"), std::string::npos);
+    EXPECT_NE(body.find("\"t1\":0.0"), std::string::npos);
+}
+
+TEST_F(VmcHttpStateTest, EmbedsTimerProgramsInTextSensorFormat)
+{
+    full_round(state, 0, 0);
+    programs[0] = simple_program();
+
+    document.refresh(state.current(), programs);
+    const std::string &body = document.body();
+
+    EXPECT_NE(body.find("\"programs\":[[" + parse_user_timer_program(programs[0], 1, 1)), std::string::npos);
+    EXPECT_NE(body.find("],null,null,null]}"), std::string::npos);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <string>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/vmc_profiler.h"
+
+// ============================================================================
+// HELPER
+// ============================================================================
+
+static HeapSnapshot heap(uint32_t free_internal, uint32_t allocated_blocks, uint32_t largest = 60000,
+                         uint32_t free_psram = 8000000)
+{
+    HeapSnapshot snapshot;
+    snapshot.free_internal = free_internal;
+    snapshot.free_psram = free_psram;
+    snapshot.largest_internal = largest;
+    snapshot.allocated_blocks = allocated_blocks;
+    return snapshot;
+}
+
+// ============================================================================
+// TEST: statistiche per sezione
+// ============================================================================
+
+TEST(VmcProfilerTest, ComputesPercentilesOfDurations)
+{
+    VmcProfiler profiler;
+    for (uint32_t i = 1; i <= 20; i++)
+        profiler.record(PROFILE_BLK1_DECODE, i * 100, 0, heap(100000, 500), heap(100000, 500));
+
+    const SectionProfile &blk1 = profiler.section(PROFILE_BLK1_DECODE);
+    EXPECT_EQ(blk1.calls(), 20u);
+    EXPECT_EQ(blk1.percentile(50), 1000u);
+    EXPECT_EQ(blk1.percentile(95), 1900u);
+    EXPECT_EQ(blk1.percentile(99), 2000u);
+    EXPECT_EQ(blk1.percentile(0), 100u);
+    EXPECT_EQ(profiler.section(PROFILE_BLK0_DECODE).calls(), 0u);
+    EXPECT_EQ(profiler.section(PROFILE_BLK0_DECODE).summary(), "no samples");
+}
+
+TEST(VmcProfilerTest, PercentilesUseOnlyRecentSamples)
+{
+    VmcProfiler profiler;
+    profiler.record(PROFILE_SCHEDULE_PARSE, 50000, 1700000000, heap(100000, 500), heap(100000, 500));
+    for (size_t i = 0; i < PROFILE_SAMPLES; i++)
+        profiler.record(PROFILE_SCHEDULE_PARSE, 300, 1700000100, heap(100000, 500), heap(100000, 500));
+
+    const SectionProfile &parse = profiler.section(PROFILE_SCHEDULE_PARSE);
+    EXPECT_EQ(parse.percentile(99), 300u);
+    // Il caso peggiore resta, con l'ora in cui è successo
+    EXPECT_EQ(parse.worst_us(), 50000u);
+    EXPECT_EQ(parse.worst_timestamp(), 1700000000u);
+}
+
+TEST(VmcProfilerTest, TracksAllocationsLeftPerCall)
+{
+    VmcProfiler profiler;
+    profiler.record(PROFILE_SCHEDULE_PUBLISH, 100, 0, heap(100000, 500), heap(99000, 507));
+    profiler.record(PROFILE_SCHEDULE_PUBLISH, 100, 0, heap(99000, 507), heap(99500, 505));
+
+    const SectionProfile &publish = profiler.section(PROFILE_SCHEDULE_PUBLISH);
+    EXPECT_EQ(publish.last_blocks(), -2);
+    EXPECT_EQ(publish.max_blocks(), 7);
+    EXPECT_EQ(publish.min_free_internal(), 99000u);
+    EXPECT_EQ(publish.summary(), "p50 100 / p95 100 / p99 100 / max 100 us, +7 blocks");
+}
+
+// ============================================================================
+// TEST: heap e report
+// ============================================================================
+
+TEST(VmcProfilerTest, KeepsHeapLowWaterAcrossSections)
+{
+    VmcProfiler profiler;
+    profiler.record(PROFILE_BLK2_DECODE, 100, 0, heap(0, 0), heap(120000, 0, 50000, 7000000));
+    profiler.record(PROFILE_SCHEDULE_WRITE, 100, 0, heap(0, 0), heap(90000, 0, 30000, 7500000));
+    profiler.record(PROFILE_BLK3_DECODE, 100, 0, heap(0, 0), heap(110000, 0, 45000, 6000000));
+
+    EXPECT_EQ(profiler.low_water().free_internal, 90000u);
+    EXPECT_EQ(profiler.low_water().largest_internal, 30000u);
+    EXPECT_EQ(profiler.low_water().free_psram, 6000000u);
+
+    profiler.reset();
+    EXPECT_EQ(profiler.section(PROFILE_BLK2_DECODE).calls(), 0u);
+    EXPECT_EQ(profiler.low_water().free_internal, 0u);
+}
+
+TEST(VmcProfilerTest, ReportListsEverySection)
+{
+    VmcProfiler profiler;
+    profiler.record(PROFILE_BLK0_DECODE, 250, 1700000000, heap(100000, 10), heap(100000, 11));
+
+    std::string json = profiler.to_json();
+    for (size_t i = 0; i < PROFILE_SECTIONS; i++)
+        EXPECT_NE(json.find(std::string("\"") + PROFILE_SECTION_NAMES[i] + "\":{"), std::string::npos);
+    EXPECT_NE(json.find("\"blk0_decode\":{\"calls\":1,\"p50\":250,\"p95\":250,\"p99\":250,\"worst\":250,"
+                        "\"worst_time\":1700000000,\"blocks\":1,\"max_blocks\":1,\"min_free_internal\":100000}"),
+              std::string::npos);
+    EXPECT_NE(json.find("\"low_water\":{\"free_internal\":100000,"), std::string::npos);
+    EXPECT_EQ(json.back(), '}');
+}
@@ -0,0 +1,318 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+// ============================================================================
+// STUB PER L'AMBIENTE ESP (prima di includere gli header reali)
+// ============================================================================
+
+// Stub per logging ESP
+#define ESP_LOGE(tag, format, ...)
+#define ESP_LOGI(tag, format, ...)
+#define ESP_LOGW(tag, format, ...)
+#define ESP_LOGD(tag, format, ...)
+
+// ============================================================================
+// INCLUDE IL CODICE REALE DAL TUO PROGETTO
+// ============================================================================
+
+#include "../config/modbus_helpers.h"
+#include "../config/vmc_state.h"
+#include "../config/modbus_link.h"
+
+// Indici dei blocchi come in modbus_link.h
+enum : uint8_t
+{
+    BLK0 = 0,
+    BLK1,
+    BLK2,
+    BLK3
+};
+
+// Immagine di un blocco con tutti i registri uguali a value
+static std::vector<uint8_t> block_image(uint8_t block, uint16_t value)
+{
+    std::vector<uint8_t> data;
+    for (uint16_t i = 0; i < VMC_STATE_BLOCK_REGISTERS[block]; i++)
+    {
+        data.push_back(value >> 8);
+        data.push_back(value & 0xFF);
+    }
+    return data;
+}
+
+static void full_round(VmcState &state, uint16_t value, uint32_t now_ms)
+{
+    for (uint8_t b = 0; b < VMC_STATE_BLOCK_COUNT; b++)
+        state.store_block(b, block_image(b, value), now_ms);
+}
+
+// ============================================================================
+// TEST: pubblicazione per round
+// ============================================================================
+
+TEST(VmcStateTest, EmptyBeforeFirstRound)
+{
+    VmcState state;
+    uint16_t value;
+
+    EXPECT_EQ(state.sequence(), 0u);
+    EXPECT_FALSE(state.current().read_register(0x0100, value));
+    EXPECT_TRUE(std::isnan(state.current().read_decimal(0x0100)));
+    EXPECT_FALSE(state.consume_new_round());
+}
+
+TEST(VmcStateTest, PublishesOnlyWhenRoundIsComplete)
+{
+    VmcState state;
+    state.store_block(BLK0, block_image(BLK0, 1), 100);
+    state.store_block(BLK1, block_image(BLK1, 1), 200);
+    state.store_block(BLK2, block_image(BLK2, 1), 300);
+
+    // Round ancora in corso: nessun dato visibile
+    EXPECT_EQ(state.sequence(), 0u);
+    EXPECT_FALSE(state.current().has_block(BLK1));
+
+    state.store_block(BLK3, block_image(BLK3, 1), 400);
+
+    EXPECT_EQ(state.sequence(), 1u);
+    EXPECT_EQ(state.current().completed_ms, 400u);
+    EXPECT_EQ(state.current().fresh_mask, 0x0F);
+    EXPECT_TRUE(state.consume_new_round());
+    EXPECT_FALSE(state.consume_new_round());
+}
+
+TEST(VmcStateTest, CurrentViewNeverMixesRounds)
+{
+    VmcState state;
+    full_round(state, 1, 0);
+    const VmcSnapshot &view = state.current();
+
+    // Round 2 a metà: la vista pubblicata resta tutta del round 1
+    state.store_block(BLK0, block_image(BLK0, 2), 30000);
+    state.store_block(BLK1, block_image(BLK1, 2), 30000);
+
+    uint16_t blk1, blk3;
+    ASSERT_TRUE(state.current().read_register(0x0105, blk1));
+    ASSERT_TRUE(state.current().read_register(0x0307, blk3));
+    EXPECT_EQ(blk1, 1);
+    EXPECT_EQ(blk3, 1);
+    EXPECT_EQ(view.sequence, 1u);
+
+    state.store_block(BLK2, block_image(BLK2, 2), 30000);
+    state.store_block(BLK3, block_image(BLK3, 2), 30000);
+
+    ASSERT_TRUE(state.current().read_register(0x0105, blk1));
+    ASSERT_TRUE(state.current().read_register(0x0307, blk3));
+    EXPECT_EQ(blk1, 2);
+    EXPECT_EQ(blk3, 2);
+    EXPECT_EQ(state.sequence(), 2u);
+}
+
+TEST(VmcStateTest, FailedBlockKeepsPreviousImage)
+{
+    VmcState state;
+    full_round(state, 1, 0);
+
+    state.store_block(BLK0, block_image(BLK0, 2), 30000);
+    state.store_block(BLK1, block_image(BLK1, 2), 30000);
+    state.fail_block(BLK2, 30000);
+    state.store_block(BLK3, block_image(BLK3, 2), 30000);
+
+    const VmcSnapshot &view = state.current();
+    uint16_t blk2;
+    ASSERT_TRUE(view.read_register(0x0210, blk2));
+    EXPECT_EQ(blk2, 1);
+    EXPECT_EQ(view.fresh_mask, 0x0B);
+    EXPECT_EQ(view.block_sequence[BLK2], 1u);
+    EXPECT_EQ(view.block_sequence[BLK1], 2u);
+}
+
+TEST(VmcStateTest, WrongSizeCountsAsFailure)
+{
+    VmcState state;
+    full_round(state, 1, 0);
+
+    state.store_block(BLK0, block_image(BLK0, 2), 30000);
+    state.store_block(BLK1, std::vector<uint8_t>(10, 0xFF), 30000);
+    state.store_block(BLK2, block_image(BLK2, 2), 30000);
+    state.store_block(BLK3, block_image(BLK3, 2), 30000);
+
+    uint16_t blk1;
+    ASSERT_TRUE(state.current().read_register(0x0100, blk1));
+    EXPECT_EQ(blk1, 1);
+    EXPECT_EQ(state.sequence(), 2u);
+}
+
+TEST(VmcStateTest, RepeatedBlockClosesIncompleteRound)
+{
+    VmcState state;
+    // Round 1: Block 3 perso (timeout, nessuna chiamata al lambda)
+    state.store_block(BLK0, block_image(BLK0, 1), 0);
+    state.store_block(BLK1, block_image(BLK1, 1), 0);
+    state.store_block(BLK2, block_image(BLK2, 1), 0);
+
+    // Round 2: Block 0 di nuovo -> il round 1 viene pubblicato così com'è
+    state.store_block(BLK0, block_image(BLK0, 2), 30000);
+
+    EXPECT_EQ(state.sequence(), 1u);
+    EXPECT_EQ(state.current().fresh_mask, 0x07);
+    EXPECT_FALSE(state.current().has_block(BLK3));
+    uint16_t blk0;
+    ASSERT_TRUE(state.current().read_register(0x0000, blk0));
+    EXPECT_EQ(blk0, 1);
+}
+
+TEST(VmcStateTest, ExplicitCommitPublishesPartialRound)
+{
+    VmcState state;
+    state.store_block(BLK1, block_image(BLK1, 7), 0);
+    state.commit(10000);
+
+    EXPECT_EQ(state.sequence(), 1u);
+    EXPECT_EQ(state.current().completed_ms, 10000u);
+
+    // Commit senza blocchi ricevuti: nessun nuovo round
+    state.commit(20000);
+    EXPECT_EQ(state.sequence(), 1u);
+}
+
+TEST(VmcStateTest, LinkRoundTimeoutPublishesPartialRound)
+{
+    VmcState state;
+    ModbusLinkMonitor link(3, 30000, 10000);
+    ASSERT_EQ(link.next_action(0), LinkAction::POLL);
+
+    // Block 2 non risponde: nessuna chiamata al lambda
+    for (uint8_t b : {BLK0, BLK1, BLK3})
+    {
+        state.store_block(b, block_image(b, 5), 1000);
+        link.on_block_result(b, true, 1000);
+    }
+    EXPECT_EQ(link.next_action(5000), LinkAction::NONE);
+    EXPECT_FALSE(link.consume_round_closed());
+    EXPECT_EQ(state.sequence(), 0u);
+
+    // Timeout del round: il YAML pubblica subito il round parziale
+    link.next_action(10000);
+    ASSERT_TRUE(link.consume_round_closed());
+    state.commit(10000);
+    EXPECT_FALSE(link.consume_round_closed());
+
+    EXPECT_EQ(state.sequence(), 1u);
+    EXPECT_TRUE(state.consume_new_round());
+    EXPECT_EQ(state.current().fresh_mask, 0x0B);
+    EXPECT_EQ(state.current().completed_ms, 10000u);
+    uint16_t blk3;
+    ASSERT_TRUE(state.current().read_register(0x0300, blk3));
+    EXPECT_EQ(blk3, 5);
+}
+
+// ============================================================================
+// TEST: accesso ai registri
+// ============================================================================
+
+TEST(VmcStateTest, ReadsDecimalSignedValues)
+{
+    VmcState state;
+    std::vector<uint8_t> blk1 = block_image(BLK1, 0);
+    blk1[0] = 0xFF; // 0x0100 T1 = -2.5 °C
+    blk1[1] = 0xE7;
+    blk1[2] = 0x00; // 0x0101 T2 = 21.3 °C
+    blk1[3] = 0xD5;
+    state.store_block(BLK1, blk1, 0);
+    state.commit(0);
+
+    EXPECT_FLOAT_EQ(state.current().read_decimal(0x0100), -2.5f);
+    EXPECT_FLOAT_EQ(state.current().read_decimal(0x0101), 21.3f);
+}
+
+TEST(VmcStateTest, RejectsAddressesOutsideBlocks)
+{
+    VmcState state;
+    full_round(state, 1, 0);
+    uint16_t value;
+
+    EXPECT_TRUE(state.current().read_register(0x000D, value));
+    EXPECT_FALSE(state.current().read_register(0x000E, value));
+    EXPECT_TRUE(state.current().read_register(0x0122, value));
+    EXPECT_FALSE(state.current().read_register(0x0123, value));
+    EXPECT_TRUE(state.current().read_register(0x0310, value));
+    EXPECT_FALSE(state.current().read_register(0x0400, value));
+}
+
+// ============================================================================
+// TEST: blob compatto per round
+// ============================================================================
+
+TEST(VmcStateBlobTest, PacksAllBlocksInOneMessage)
+{
+    VmcState state;
+    full_round(state, 0x1234, 0);
+    std::vector<uint8_t> blob;
+
+    size_t size = vmc_state_pack(state.current(), blob);
+
+    // Header + 28 + 70 + 102 + 34 byte di immagini + CRC
+    EXPECT_EQ(size, VMC_STATE_BLOB_HEADER_SIZE + 234u + 2u);
+    EXPECT_EQ(blob[0], 'V');
+    EXPECT_EQ(blob[2], VMC_STATE_SCHEMA_ID);
+    EXPECT_EQ(blob[4], 0x0F);
+    EXPECT_EQ(blob[8], 1); // sequence
+}
+
+TEST(VmcStateBlobTest, RoundTripsSnapshot)
+{
+    VmcState state;
+    full_round(state, 1, 0);
+    full_round(state, 0xBEEF, 30000);
+    std::vector<uint8_t> blob;
+    vmc_state_pack(state.current(), blob);
+
+    VmcSnapshot decoded;
+    ASSERT_TRUE(vmc_state_unpack(blob, decoded));
+
+    uint16_t value;
+    EXPECT_EQ(decoded.sequence, 2u);
+    ASSERT_TRUE(decoded.read_register(0x0232, value));
+    EXPECT_EQ(value, 0xBEEF);
+    ASSERT_TRUE(decoded.read_register(0x0000, value));
+    EXPECT_EQ(value, 0xBEEF);
+}
+
+TEST(VmcStateBlobTest, OmitsBlocksNeverRead)
+{
+    VmcState state;
+    state.store_block(BLK1, block_image(BLK1, 5), 0);
+    state.commit(0);
+    std::vector<uint8_t> blob;
+
+    EXPECT_EQ(vmc_state_pack(state.current(), blob), VMC_STATE_BLOB_HEADER_SIZE + 70u + 2u);
+
+    VmcSnapshot decoded;
+    ASSERT_TRUE(vmc_state_unpack(blob, decoded));
+    EXPECT_TRUE(decoded.has_block(BLK1));
+    EXPECT_FALSE(decoded.has_block(BLK2));
+}
+
+TEST(VmcStateBlobTest, RejectsCorruptedOrForeignBlobs)
+{
+    VmcState state;
+    full_round(state, 1, 0);
+    std::vector<uint8_t> blob;
+    vmc_state_pack(state.current(), blob);
+    VmcSnapshot decoded;
+
+    std::vector<uint8_t> corrupted = blob;
+    corrupted[50] ^= 0x80;
+    EXPECT_FALSE(vmc_state_unpack(corrupted, decoded));
+
+    corrupted = blob;
+    corrupted[2] = VMC_STATE_SCHEMA_ID + 1;
+    EXPECT_FALSE(vmc_state_unpack(corrupted, decoded));
+
+    corrupted = blob;
+    corrupted.resize(20);
+    EXPECT_FALSE(vmc_state_unpack(corrupted, decoded));
+}